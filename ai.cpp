@@ -0,0 +1,177 @@
+#include "ai.hpp"
+
+//Types that update every tick regardless of distance. Projectiles must test hits each tick. 
+static const bool AI_LOD_EXEMPT[AI_TYPE_COUNT] = {
+	false, 
+	true, //FIREBALL
+}; 
+
+//Types that can be hit. Their hitboxes go out every tick, whether or not they were scheduled. 
+static const bool AI_HITTABLE[AI_TYPE_COUNT] = {
+	false, 
+	false, //FIREBALL
+	true, //FIREFLY
+}; 
+
+//Direction toward the nearest player along the flow field. Steers straight at the player on its 
+//own tile, and returns false when there's no route. 
+static bool flow_direction(Gamestate *g, glm::dvec2 p, glm::dvec2 *dir) {
+	FlowField *f = nearest_flow_field(&g->flow_fields, p); 
+	if(f == nullptr) {
+		return false; 
+	}
+	if(sample_flow(f, p, dir)) {
+		return true; 
+	}
+	glm::dvec2 d = f->target_pos - p; 
+	if(glm::dot(d, d) > 0 && floor(p.y) == f->target_tile.row && floor(p.x) == f->target_tile.col) {
+		*dir = d / glm::length(d); 
+		return true; 
+	}
+	return false; 
+}
+
+static void fireball_kernel(Gamestate *g, const int *indices, int count) {
+	RollbackECS *ecs = g->ecs; 
+	for (int k = 0; k < count; k++) {
+		AIData *ad = &ecs->ai_data[indices[k]]; 
+		int eid = ad->entity_id; 
+		FireballAI *fb_a = &ad->data.fa; 
+		Entity *e = &ecs->entities[ecs->entity_map[eid]]; 
+		fb_a->step += ai_elapsed(ad, g->frame); 
+		glm::dvec2 dir; 
+		double speed = glm::length(e->vel); 
+		if(fb_a->tracking && speed > 0 && flow_direction(g, e->pos + e->dim * 0.5, &dir)) {
+			glm::dvec2 v = e->vel / speed + dir * FIREBALL_TURN; 
+			e->vel = v / glm::length(v) * speed; 
+		}
+		Hurtbox h = {parent_id: e->entity_id, pos: e->pos, dim: e->dim, weight: 1, power: fb_a->power, 
+						attack_id: fb_a->attack_id, lifetime: fb_a->lifespan}; 
+		//Sweep over last tick's motion so fast fireballs can't skip past targets. 
+		glm::dvec2 center = e->pos + e->dim * 0.5; 
+		double radius = 0.5 * std::min(e->dim.x, e->dim.y); 
+		g->hurtboxes.push(h, capsuleShape(center - e->vel, center, radius)); 
+		if(fb_a->step >= fb_a->lifespan) {
+			ecs->delete_entity(eid); 
+		}
+	}
+}
+
+static void firefly_kernel(Gamestate *g, const int *indices, int count) {
+	RollbackECS *ecs = g->ecs; 
+	for (int k = 0; k < count; k++) {
+		AIData *ad = &ecs->ai_data[indices[k]]; 
+		ai_elapsed(ad, g->frame); 
+		Entity *e = &ecs->entities[ecs->entity_map[ad->entity_id]]; 
+		glm::dvec2 dir; 
+		if(ad->data.fb.tracking && flow_direction(g, e->pos + e->dim * 0.5, &dir)) {
+			e->vel += (dir * FIREFLY_SPEED - e->vel) * FIREFLY_STEER; 
+		}
+	}
+}
+
+static const AIKernel AI_KERNELS[AI_TYPE_COUNT] = {
+	nullptr, //No AI type 0. 
+	fireball_kernel, //FIREBALL
+	firefly_kernel, //FIREFLY
+}; 
+
+AIKernel ai_kernel(uint32_t type) {
+	return AI_KERNELS[ai_type_slot(type)]; 
+}
+
+uint32_t ai_elapsed(AIData *ad, uint32_t frame) {
+	uint32_t elapsed = frame - ad->last_tick; 
+	ad->last_tick = frame; 
+	return elapsed; 
+}
+
+//Squared distance from p to the closest player, or INFINITY with no players. 
+static double nearest_player_dist2(RollbackECS *ecs, glm::dvec2 p) {
+	double best = INFINITY; 
+	for (int i = 0; i < ecs->player_data.size(); i++) {
+		int eid = ecs->player_data[i].entity_id; 
+		if(ecs->player_map[eid] != i || ecs->entity_map[eid] < 0) {
+			continue; 
+		}
+		glm::dvec2 d = ecs->entities[ecs->entity_map[eid]].pos - p; 
+		best = std::min(best, glm::dot(d, d)); 
+	}
+	return best; 
+}
+
+static AILod ai_lod(RollbackECS *ecs, AIData *ad) {
+	if(AI_LOD_EXEMPT[ai_type_slot(ad->type)]) {
+		return AI_LOD_NEAR; 
+	}
+	double d2 = nearest_player_dist2(ecs, ecs->entities[ecs->entity_map[ad->entity_id]].pos); 
+	if(d2 <= AI_NEAR_DISTANCE * AI_NEAR_DISTANCE) {
+		return AI_LOD_NEAR; 
+	}
+	return d2 <= AI_FAR_DISTANCE * AI_FAR_DISTANCE ? AI_LOD_MID : AI_LOD_DORMANT; 
+}
+
+void schedule_ai(Gamestate *g) {
+	RollbackECS *ecs = g->ecs; 
+	AISchedule *s = &g->ai_schedule; 
+	s->indices.clear(); 
+	s->lod_count[AI_LOD_NEAR] = 0; s->lod_count[AI_LOD_MID] = 0; s->lod_count[AI_LOD_DORMANT] = 0; 
+	//Entries pushed since the last save haven't updated yet. 
+	for (int i = ecs->ai_type_start[AI_TYPE_COUNT]; i < ecs->ai_data.size(); i++) {
+		ecs->ai_data[i].last_tick = g->frame - 1; 
+	}
+	//Grouped entries in order, then the unsorted tail placed into its type's group. 
+	for (int t = 0; t < AI_TYPE_COUNT; t++) {
+		s->type_start[t] = s->indices.size(); 
+		if(!AI_KERNELS[t]) {
+			continue; 
+		}
+		for (int i = ecs->ai_type_start[t]; i < ecs->ai_type_start[t+1]; i++) {
+			AIData *ad = &ecs->ai_data[i]; 
+			if(ecs->ai_map[ad->entity_id] != i) {
+				continue; 
+			}
+			AILod lod = ai_lod(ecs, ad); 
+			s->lod_count[lod] += 1; 
+			if(lod == AI_LOD_NEAR || (lod == AI_LOD_MID && (g->frame + ad->entity_id) % AI_MID_PERIOD == 0)) {
+				s->indices.push_back(i); 
+			}
+		}
+		for (int i = ecs->ai_type_start[AI_TYPE_COUNT]; i < ecs->ai_data.size(); i++) {
+			AIData *ad = &ecs->ai_data[i]; 
+			if(ecs->ai_map[ad->entity_id] == i && ai_type_slot(ad->type) == t) {
+				s->lod_count[AI_LOD_NEAR] += 1; 
+				s->indices.push_back(i); //New entries update on their first tick. 
+			}
+		}
+	}
+	s->type_start[AI_TYPE_COUNT] = s->indices.size(); 
+}
+
+//Level of detail only throttles behavior. Whether an attack lands can't depend on how far 
+//the target is from a player, so every live hittable entry is covered each tick. 
+static void broadcast_ai_hitboxes(Gamestate *g) {
+	RollbackECS *ecs = g->ecs; 
+	for (int i = 0; i < ecs->ai_data.size(); i++) {
+		AIData *ad = &ecs->ai_data[i]; 
+		int eid = ad->entity_id; 
+		if(ecs->ai_map[eid] != i || ecs->entity_map[eid] < 0 || !AI_HITTABLE[ai_type_slot(ad->type)]) {
+			continue; 
+		}
+		Entity *e = &ecs->entities[ecs->entity_map[eid]]; 
+		Hitbox h = {id: g->hitboxes.count, parent_id: eid, pos: e->pos, dim: e->dim}; 
+		g->hitboxes.push(h); 
+	}
+}
+
+void run_ai(Gamestate *g) {
+	schedule_ai(g); 
+	AISchedule *s = &g->ai_schedule; 
+	for (int t = 0; t < AI_TYPE_COUNT; t++) {
+		int count = s->type_start[t+1] - s->type_start[t]; 
+		if(AI_KERNELS[t] && count > 0) {
+			AI_KERNELS[t](g, s->indices.data() + s->type_start[t], count); 
+		}
+	}
+	broadcast_ai_hitboxes(g); 
+}
@@ -0,0 +1,31 @@
+#ifndef HEADERFILE_AI
+#define HEADERFILE_AI
+
+#include "game_world.hpp"
+
+/*
+AI runs one behavior at a time. save_update keeps ecs->ai_data grouped by type, and schedule_ai 
+picks this tick's entries in that order, so each behavior is a kernel over a contiguous list 
+with no per-entry type branch. 
+
+Entries are scheduled by distance to the nearest player: every tick when near, every 
+AI_MID_PERIOD ticks at mid range, phased by entity id so the cost stays flat, and not at all 
+when far. Scheduling only reads simulation state and the frame, so rollback replays it exactly. 
+It only throttles behavior. Hitboxes are pushed for every live entry each tick in a separate pass. 
+*/
+const double FIREFLY_SPEED = 0.05; 
+const double FIREFLY_STEER = 0.2; //Fraction of the way velocity turns toward the flow each update. 
+const double FIREBALL_TURN = 0.15; //Tracking fireballs turn this much toward the flow per tick, keeping speed. 
+
+typedef void (*AIKernel)(Gamestate *g, const int *indices, int count); 
+
+//Kernel for each AI type, null for types with no behavior yet. 
+AIKernel ai_kernel(uint32_t type); 
+//Ticks since ad last updated, and marks it updated this frame. 
+uint32_t ai_elapsed(AIData *ad, uint32_t frame); 
+//Fills g->ai_schedule for g->frame. 
+void schedule_ai(Gamestate *g); 
+//Schedules and runs every behavior for one tick, then pushes the hitbox of every live hittable AI into g. 
+void run_ai(Gamestate *g); 
+
+#endif
@@ -0,0 +1,165 @@
+#include "atlas.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static bool valid_string(const AtlasManifest *m, uint32_t offset) {
+	return offset < m->header->string_bytes; 
+}
+
+bool view_manifest(AtlasManifest *m, const char *data, size_t size) {
+	m->data = data; 
+	m->size = size; 
+	m->mapped = false; 
+	const AtlasHeader *h = (const AtlasHeader*) data; 
+	if(size < sizeof(AtlasHeader) || memcmp(h->magic, ATLAS_MAGIC, 4) != 0 || h->version != ATLAS_VERSION) {
+		printf("Manifest is not a version %d sprite manifest\n", ATLAS_VERSION); 
+		return false; 
+	}
+	size_t expected = sizeof(AtlasHeader) + h->page_count*sizeof(AtlasPage) + h->sprite_count*sizeof(AtlasSprite) +
+						h->tile_count*sizeof(AtlasTile) + h->string_bytes; 
+	if(size != expected || h->string_bytes == 0 || data[size - 1] != '\0') {
+		printf("Manifest is %zu bytes, expected %zu\n", size, expected); 
+		return false; 
+	}
+	m->header = h; 
+	m->pages = (const AtlasPage*) (data + sizeof(AtlasHeader)); 
+	m->sprites = (const AtlasSprite*) (m->pages + h->page_count); 
+	m->tiles = (const AtlasTile*) (m->sprites + h->sprite_count); 
+	m->strings = (const char*) (m->tiles + h->tile_count); 
+	for (int i = 0; i < h->page_count; i++) {
+		if(!valid_string(m, m->pages[i].path)) return false; 
+	}
+	for (int i = 0; i < h->sprite_count; i++) {
+		const AtlasSprite *s = &m->sprites[i]; 
+		if(!valid_string(m, s->name) || s->page >= h->page_count || s->frames == 0) {
+			printf("Manifest sprite %d is invalid\n", i); 
+			return false; 
+		}
+	}
+	for (int i = 0; i < h->tile_count; i++) {
+		if(m->tiles[i].page >= h->page_count) {
+			printf("Manifest tile %d is invalid\n", i + 1); 
+			return false; 
+		}
+	}
+	return true; 
+}
+
+bool map_manifest(AtlasManifest *m, const char *path) {
+	m->data = NULL; 
+	m->mapped = false; 
+	const char *data = NULL; 
+	size_t size = 0; 
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL); 
+	if(file == INVALID_HANDLE_VALUE) {
+		printf("Unable to open manifest %s\n", path); 
+		return false; 
+	}
+	size = GetFileSize(file, NULL); 
+	HANDLE mapping = size > 0 ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL; 
+	CloseHandle(file); 
+	if(mapping != NULL) {
+		data = (const char*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0); 
+		CloseHandle(mapping); //The view keeps the mapping alive.
+	}
+#else
+	int fd = open(path, O_RDONLY); 
+	if(fd < 0) {
+		printf("Unable to open manifest %s\n", path); 
+		return false; 
+	}
+	struct stat st; 
+	if(fstat(fd, &st) == 0 && st.st_size > 0) {
+		size = st.st_size; 
+		void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0); 
+		data = p == MAP_FAILED ? NULL : (const char*) p; 
+	}
+	close(fd); 
+#endif
+	if(data == NULL) {
+		printf("Unable to map manifest %s\n", path); 
+		return false; 
+	}
+	bool valid = view_manifest(m, data, size); 
+	m->mapped = true; 
+	if(!valid) {
+		printf("Manifest %s is invalid\n", path); 
+		close_manifest(m); 
+	}
+	return valid; 
+}
+
+void close_manifest(AtlasManifest *m) {
+	if(m->mapped && m->data != NULL) {
+#ifdef _WIN32
+		UnmapViewOfFile(m->data); 
+#else
+		munmap((void*) m->data, m->size); 
+#endif
+	}
+	m->data = NULL; 
+	m->mapped = false; 
+}
+
+const AtlasSprite* find_manifest_sprite(const AtlasManifest *m, const char *name) {
+	int lo = 0, hi = m->header->sprite_count; 
+	while (lo < hi) {
+		int mid = (lo + hi) / 2; 
+		int c = strcmp(manifest_string(m, m->sprites[mid].name), name); 
+		if(c == 0) return &m->sprites[mid]; 
+		if(c < 0) lo = mid + 1; 
+		else hi = mid; 
+	}
+	return NULL; 
+}
+
+static uint32_t add_string(std::vector<char> *strings, const std::string *s) {
+	uint32_t offset = strings->size(); 
+	strings->insert(strings->end(), s->c_str(), s->c_str() + s->size() + 1); 
+	return offset; 
+}
+
+void write_manifest(std::vector<char> *out, const std::vector<std::string> *pages,
+					std::vector<ManifestSprite> sprites, const std::vector<AtlasTile> *tiles) {
+	std::sort(sprites.begin(), sprites.end(), [](const ManifestSprite &a, const ManifestSprite &b) {
+		return strcmp(a.name.c_str(), b.name.c_str()) < 0; 
+	}); 
+	std::vector<char> strings; 
+	std::vector<AtlasPage> page_records; 
+	for (int i = 0; i < pages->size(); i++) {
+		page_records.push_back(AtlasPage {add_string(&strings, &(*pages)[i])}); 
+	}
+	std::vector<AtlasSprite> sprite_records; 
+	for (int i = 0; i < sprites.size(); i++) {
+		ManifestSprite *s = &sprites[i]; 
+		sprite_records.push_back(AtlasSprite {add_string(&strings, &s->name), s->page, s->frames, s->x, s->y, s->w, s->h}); 
+	}
+	//Pad so the file stays a multiple of 4 bytes. The padding also terminates the table.
+	do {
+		strings.push_back('\0'); 
+	} while (strings.size() % 4 != 0); 
+
+	AtlasHeader header; 
+	memcpy(header.magic, ATLAS_MAGIC, 4); 
+	header.version = ATLAS_VERSION; 
+	header.page_count = page_records.size(); 
+	header.sprite_count = sprite_records.size(); 
+	header.tile_count = tiles->size(); 
+	header.string_bytes = strings.size(); 
+	out->clear(); 
+	out->insert(out->end(), (char*) &header, (char*) (&header + 1)); 
+	out->insert(out->end(), (char*) page_records.data(), (char*) (page_records.data() + page_records.size())); 
+	out->insert(out->end(), (char*) sprite_records.data(), (char*) (sprite_records.data() + sprite_records.size())); 
+	out->insert(out->end(), (char*) tiles->data(), (char*) (tiles->data() + tiles->size())); 
+	out->insert(out->end(), strings.begin(), strings.end()); 
+}
@@ -0,0 +1,81 @@
+#ifndef HEADERFILE_ATLAS
+#define HEADERFILE_ATLAS
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/*
+Binary sprite manifest, written by tools/pack_atlas and tools/compile_manifest and used in place
+at runtime. Laid out as an AtlasHeader, then page_count AtlasPages, sprite_count AtlasSprites
+sorted by name, tile_count AtlasTiles and string_bytes of null terminated strings that names and
+paths point into. Every record is 4 byte aligned, so the file can be mapped and read directly.
+Tile id t is tiles[t-1], so the tile set isn't tied to the layout of any one image.
+*/
+
+const char ATLAS_MAGIC[4] = {'A', 'T', 'L', 'S'}; 
+const uint32_t ATLAS_VERSION = 2; 
+
+struct AtlasHeader {
+	char magic[4]; 
+	uint32_t version; 
+	uint32_t page_count; 
+	uint32_t sprite_count; 
+	uint32_t tile_count; 
+	uint32_t string_bytes; 
+}; 
+
+struct AtlasPage {
+	uint32_t path; //String table offset of the page's PNG.
+}; 
+
+struct AtlasSprite {
+	uint32_t name; //String table offset.
+	uint16_t page; 
+	uint16_t frames; //Frames lie side by side, so the rect covers all of them.
+	int32_t x, y, w, h; 
+}; 
+
+struct AtlasTile {
+	uint16_t page; 
+	uint16_t padding; 
+	int32_t x, y, w, h; 
+}; 
+
+//A manifest mapped from a file or viewed in a caller's buffer. Pointers point into data.
+struct AtlasManifest {
+	const char *data; 
+	size_t size; 
+	bool mapped; //data is a file mapping to release with close_manifest.
+	const AtlasHeader *header; 
+	const AtlasPage *pages; 
+	const AtlasSprite *sprites; 
+	const AtlasTile *tiles; 
+	const char *strings; 
+}; 
+
+//Maps the manifest at path. Returns false, with a message, if it's missing or invalid.
+bool map_manifest(AtlasManifest *m, const char *path); 
+//Uses a manifest already in memory. data must outlive m.
+bool view_manifest(AtlasManifest *m, const char *data, size_t size); 
+void close_manifest(AtlasManifest *m); 
+//Binary search by name. Null if there's no such sprite.
+const AtlasSprite* find_manifest_sprite(const AtlasManifest *m, const char *name); 
+inline const char* manifest_string(const AtlasManifest *m, uint32_t offset) {
+	return m->strings + offset; 
+}
+
+//Sprite as given to write_manifest, before its name goes into the string table.
+struct ManifestSprite {
+	std::string name; 
+	uint16_t page; 
+	uint16_t frames; 
+	int32_t x, y, w, h; 
+}; 
+
+//Serializes a manifest into out, sorting sprites by name.
+void write_manifest(std::vector<char> *out, const std::vector<std::string> *pages,
+					std::vector<ManifestSprite> sprites, const std::vector<AtlasTile> *tiles); 
+
+#endif
@@ -6,6 +6,126 @@ bool operator==(const BlockIndices b1, const BlockIndices b2){
 	return b1.col == b2.col && b1.row == b2.row && b1.chunk_col == b2.chunk_col && b1.chunk_row == b2.chunk_row; 
 }
 
+bool operator==(const ChunkIndices c1, const ChunkIndices c2){
+	return c1.row == c2.row && c1.col == c2.col; 
+}
+
+ChunkIndices b2c(BlockIndices b) {
+	ChunkIndices c = {b.chunk_row, b.chunk_col}; 
+	return c; 
+}
+
+ChunkIndices pos2c(glm::dvec2 p) {
+	ChunkIndices c = {(int) floor(p.y / CHUNK_WIDTH), (int) floor(p.x / CHUNK_WIDTH)}; 
+	return c; 
+}
+
+static inline uint32_t chunk_slot(uint64_t key, int shift) {
+	return (uint32_t) ((key * 0x9E3779B97F4A7C15ull) >> shift); 
+}
+
+ChunkMap::ChunkMap(int capacity) {
+	int bits = 4; 
+	while((1 << bits) < capacity) {
+		bits += 1; 
+	}
+	keys.assign(1 << bits, 0); 
+	values.assign(1 << bits, nullptr); 
+	mask = (1 << bits) - 1; 
+	shift = 64 - bits; 
+	count = 0; 
+	generation = 0; 
+}
+
+Chunk* ChunkMap::find(ChunkIndices c) {
+	uint64_t key = pack_chunk(c); 
+	for (uint32_t i = chunk_slot(key, shift);; i = (i + 1) & mask) {
+		if(values[i] == nullptr) {
+			return nullptr; 
+		}
+		if(keys[i] == key) {
+			return values[i]; 
+		}
+	}
+}
+
+void ChunkMap::insert(ChunkIndices c, Chunk *chunk) {
+	if(2*(count + 1) > keys.size()) { //Keep load factor at or below 1/2. 
+		grow(); 
+	}
+	uint64_t key = pack_chunk(c); 
+	uint32_t i = chunk_slot(key, shift); 
+	while(values[i] != nullptr && keys[i] != key) {
+		i = (i + 1) & mask; 
+	}
+	if(values[i] == nullptr) {
+		count += 1; 
+	} else if(values[i] != chunk) {
+		generation += 1; //Cursors may still hold the chunk being replaced. 
+	}
+	keys[i] = key; 
+	values[i] = chunk; 
+}
+
+Chunk* ChunkMap::erase(ChunkIndices c) {
+	uint64_t key = pack_chunk(c); 
+	uint32_t i = chunk_slot(key, shift); 
+	while(values[i] != nullptr && keys[i] != key) {
+		i = (i + 1) & mask; 
+	}
+	Chunk *removed = values[i]; 
+	if(removed == nullptr) {
+		return nullptr; 
+	}
+	//Backward shift: pull later entries of the probe run into the hole. 
+	uint32_t hole = i; 
+	for (uint32_t j = (i + 1) & mask; values[j] != nullptr; j = (j + 1) & mask) {
+		uint32_t home = chunk_slot(keys[j], shift); 
+		if(((j - home) & mask) >= ((j - hole) & mask)) {
+			keys[hole] = keys[j]; 
+			values[hole] = values[j]; 
+			hole = j; 
+		}
+	}
+	values[hole] = nullptr; 
+	count -= 1; 
+	generation += 1; 
+	return removed; 
+}
+
+void ChunkMap::grow() {
+	std::vector<uint64_t> old_keys; old_keys.swap(keys); 
+	std::vector<Chunk*> old_values; old_values.swap(values); 
+	int size = old_keys.size() * 2; 
+	keys.assign(size, 0); 
+	values.assign(size, nullptr); 
+	mask = size - 1; 
+	shift -= 1; 
+	for (int i = 0; i < old_keys.size(); i++) {
+		if(old_values[i] == nullptr) {
+			continue; 
+		}
+		uint32_t j = chunk_slot(old_keys[i], shift); 
+		while(values[j] != nullptr) {
+			j = (j + 1) & mask; 
+		}
+		keys[j] = old_keys[i]; 
+		values[j] = old_values[i]; 
+	}
+}
+
+Chunk* find_chunk(ChunkMap *m, ChunkIndices c, ChunkCursor *cursor) {
+	uint64_t key = pack_chunk(c); 
+	if(cursor->chunk != nullptr && cursor->key == key && cursor->generation == m->generation) {
+		return cursor->chunk; 
+	}
+	Chunk *chunk = m->find(c); 
+	cursor->key = key; 
+	cursor->chunk = chunk; 
+	cursor->generation = m->generation; 
+	return chunk; 
+}
+
 //Squares are represented by row and column. 
 void listIntersectingSquares(glm::dvec2 s, glm::dvec2 e, std::vector<BlockIndices> *l) {
 	float can = s.x + s.y + e.x + e.y; 
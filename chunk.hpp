@@ -3,6 +3,7 @@
 
 #include <glm/glm.hpp>
 #include <vector>
+#include <functional>
 
 const double TILE_WIDTH = 1; 
 const int CHUNK_TILES = 32; 
@@ -17,6 +18,9 @@ struct Chunk {
 	int row;
 	int col; 
 	Tile tiles[CHUNK_TILES*CHUNK_TILES];
+	uint32_t last_used; //Cache tick of last access, for LRU eviction. 
+	uint32_t pin_tick; //Chunk can't be evicted during the cache tick it was pinned in. 
+	bool dirty; //Tiles differ from generated or saved copy. 
 }; 
 
 struct BlockIndices {
@@ -26,6 +30,54 @@ struct BlockIndices {
 
 bool operator==(const BlockIndices b1, const BlockIndices b2); 
 
+struct ChunkIndices {
+	int row, col; 
+}; 
+
+bool operator==(const ChunkIndices c1, const ChunkIndices c2); 
+ChunkIndices b2c(BlockIndices b); //Chunk containing block b. 
+ChunkIndices pos2c(glm::dvec2 p); //Chunk containing point p. 
+
+template<> struct std::hash<ChunkIndices> {
+	size_t operator()(const ChunkIndices c) const {
+		return std::hash<uint64_t>()(((uint64_t) (uint32_t) c.row << 32) | (uint32_t) c.col); 
+	}
+}; 
+
+//Packs chunk coordinates into a single map key. 
+inline uint64_t pack_chunk(ChunkIndices c) {
+	return ((uint64_t) (uint32_t) c.row << 32) | (uint32_t) c.col; 
+}
+
+/*
+Flat open-addressing table of loaded chunks. Capacity is a power of two, probing is linear, 
+and erase shifts entries back so no tombstones are needed. A null value marks an empty slot. 
+Chunk pointers stay valid across growth, only erase and replace invalidate them. 
+*/
+struct ChunkMap {
+	std::vector<uint64_t> keys; 
+	std::vector<Chunk*> values; 
+	uint32_t mask; 
+	int shift; 
+	int count; 
+	uint32_t generation; //Incremented on erase and replace so ChunkCursors drop stale pointers. 
+
+	Chunk* find(ChunkIndices c); 
+	void insert(ChunkIndices c, Chunk *chunk); //Replaces any chunk already at c. 
+	Chunk* erase(ChunkIndices c); //Returns removed chunk, or null. Caller owns it. 
+	void grow(); 
+	ChunkMap(int capacity); 
+}; 
+
+//Per-caller record of the last chunk hit. Consecutive lookups in one chunk skip hashing. 
+struct ChunkCursor {
+	uint64_t key; 
+	Chunk *chunk = nullptr; 
+	uint32_t generation = 0; 
+}; 
+
+Chunk* find_chunk(ChunkMap *m, ChunkIndices c, ChunkCursor *cursor); 
+
 enum ContactSide {
 	LEFT=0, RIGHT, TOP, BOTTOM
 }; 
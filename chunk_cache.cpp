@@ -0,0 +1,110 @@
+#include "chunk_cache.hpp"
+#include <stdio.h>
+#include <filesystem>
+
+double chunk_cache_hit_rate(ChunkCacheStats s) {
+	uint64_t total = s.hits + s.misses; 
+	if(total == 0) {
+		return 1.0; 
+	}
+	return (double) s.hits / total; 
+}
+
+static std::string chunk_path(std::string dir, int row, int col) {
+	return dir + "/c_" + std::to_string(row) + "_" + std::to_string(col) + ".chunk"; 
+}
+
+static void write_chunk(std::string dir, Chunk *chunk) {
+	std::string path = chunk_path(dir, chunk->row, chunk->col); 
+	FILE *f = fopen(path.c_str(), "wb"); 
+	if(f == NULL) {
+		printf("WARNING: Unable to save chunk to %s, edits lost\n", path.c_str()); 
+		return; 
+	}
+	fwrite(chunk->tiles, sizeof(Tile), CHUNK_TILES*CHUNK_TILES, f); 
+	fclose(f); 
+}
+
+ChunkCache::ChunkCache() : ChunkCache(DEFAULT_CHUNK_BUDGET, "saves") {
+}
+
+ChunkCache::ChunkCache(size_t budget, std::string dir) {
+	budget_bytes = budget; 
+	tick = 1; //Fresh chunks have pin_tick 0, so they start unpinned. 
+	stats = {0}; 
+	save_dir = dir; 
+	writing = false; 
+	stop = false; 
+}
+
+ChunkCache::~ChunkCache() {
+	if(writer.joinable()) {
+		{
+			std::lock_guard<std::mutex> g(lock); 
+			stop = true; 
+		}
+		wake.notify_one(); 
+		writer.join(); 
+	}
+}
+
+void ChunkCache::queue_write(Chunk *chunk) {
+	if(!writer.joinable()) { //Start writer on first dirty eviction. 
+		std::error_code err; 
+		std::filesystem::create_directories(save_dir, err); 
+		writer = std::thread([this]() {
+			std::unique_lock<std::mutex> g(lock); 
+			while(true) {
+				wake.wait(g, [this]() { return stop || write_queue.size() > 0; }); 
+				if(write_queue.size() == 0) {
+					return; //Stopped with nothing left to write. 
+				}
+				Chunk *chunk = write_queue.back(); 
+				write_queue.pop_back(); 
+				writing = true; 
+				writing_at = {chunk->row, chunk->col}; 
+				g.unlock(); 
+				write_chunk(save_dir, chunk); 
+				delete chunk; 
+				g.lock(); 
+				writing = false; 
+				written.notify_all(); 
+			}
+		}); 
+	}
+	{
+		std::lock_guard<std::mutex> g(lock); 
+		write_queue.push_back(chunk); 
+	}
+	wake.notify_one(); 
+}
+
+Chunk* ChunkCache::rescue(ChunkIndices c) {
+	std::unique_lock<std::mutex> g(lock); 
+	for (int i = 0; i < write_queue.size(); i++) {
+		Chunk *chunk = write_queue[i]; 
+		if(chunk->row == c.row && chunk->col == c.col) {
+			write_queue[i] = write_queue.back(); 
+			write_queue.pop_back(); 
+			return chunk; 
+		}
+	}
+	//Chunk may be half written. Wait so read_saved sees the whole file. 
+	written.wait(g, [this, c]() { return !writing || !(writing_at == c); }); 
+	return nullptr; 
+}
+
+bool ChunkCache::read_saved(Chunk *chunk) {
+	FILE *f = fopen(chunk_path(save_dir, chunk->row, chunk->col).c_str(), "rb"); 
+	if(f == NULL) {
+		return false; 
+	}
+	size_t n = fread(chunk->tiles, sizeof(Tile), CHUNK_TILES*CHUNK_TILES, f); 
+	fclose(f); 
+	return n == CHUNK_TILES*CHUNK_TILES; 
+}
+
+void ChunkCache::flush() {
+	std::unique_lock<std::mutex> g(lock); 
+	written.wait(g, [this]() { return write_queue.size() == 0 && !writing; }); 
+}
@@ -0,0 +1,55 @@
+#ifndef HEADERFILE_CHUNK_CACHE
+#define HEADERFILE_CHUNK_CACHE
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "chunk.hpp"
+
+const size_t DEFAULT_CHUNK_BUDGET = 64 << 20; //Bytes of resident chunk data. 
+
+struct ChunkCacheStats {
+	uint64_t hits; //load_chunk found chunk resident. 
+	uint64_t misses; 
+	uint64_t evictions; 
+	uint64_t persisted; //Evicted dirty chunks written to disk. 
+	uint64_t rescued; //Chunks reloaded from the write queue before they reached disk. 
+	uint64_t loaded; //Chunks read back from disk. 
+}; 
+
+double chunk_cache_hit_rate(ChunkCacheStats s); 
+
+/*
+Bookkeeping for a memory budgeted set of chunks. Recency is stamped on each chunk as the 
+cache tick it was last used, and eviction takes the oldest unpinned chunks once resident 
+bytes pass the budget. Clean chunks are regenerated from the seed, so only dirty chunks are 
+handed to a background thread that writes them to save_dir and frees them. 
+*/
+struct ChunkCache {
+	size_t budget_bytes; 
+	uint32_t tick; 
+	ChunkCacheStats stats; 
+	std::string save_dir; 
+
+	//Shared with the writer thread. 
+	std::mutex lock; 
+	std::condition_variable wake; 
+	std::condition_variable written; 
+	std::vector<Chunk*> write_queue; 
+	bool writing; //Writer has taken a chunk off the queue and not yet finished with it. 
+	ChunkIndices writing_at; //Which chunk, copied so waiters never touch the chunk the writer frees. 
+	bool stop; 
+	std::thread writer; 
+
+	void queue_write(Chunk *chunk); 
+	Chunk* rescue(ChunkIndices c); //Removes c from the write queue if present, waiting out an in-flight write. 
+	bool read_saved(Chunk *chunk); //Fills chunk tiles from save_dir. False if never saved. 
+	void flush(); //Blocks until the write queue is empty. 
+	ChunkCache(); 
+	ChunkCache(size_t budget, std::string dir); 
+	~ChunkCache(); 
+}; 
+
+#endif
@@ -0,0 +1,137 @@
+#include "chunk_render.hpp"
+#include "renderer.hpp"
+#include <stdio.h>
+#include <string.h>
+
+//Baked textures lose their contents when the render targets are reset, and the textures
+//themselves when the device is. Both arrive as events, so watch for them here.
+static int watch_render_reset(void *data, SDL_Event *e) {
+	ChunkTextures *ct = (ChunkTextures*) data; 
+	if(e->type == SDL_RENDER_TARGETS_RESET || e->type == SDL_RENDER_DEVICE_RESET) {
+		for (auto& it : ct->textures) {
+			if(e->type == SDL_RENDER_DEVICE_RESET && it.second.texture != NULL) {
+				SDL_DestroyTexture(it.second.texture); 
+				it.second.texture = NULL; 
+			}
+			it.second.baked = false; 
+		}
+	}
+	return 0; 
+}
+
+ChunkTextures::ChunkTextures(SpriteSheet *sheet) {
+	this->sheet = sheet; 
+	frame = 0; 
+	bakes = 0; 
+	tile_redraws = 0; 
+	SDL_AddEventWatch(watch_render_reset, this); 
+}
+
+//Square of tile index in the baked texture. Rows go up in world space and down in textures.
+static SDL_Rect tile_rect(int index) {
+	int row = index / CHUNK_TILES; int col = index % CHUNK_TILES; 
+	SDL_Rect r = {col*BAKE_TILE_PIXELS, (CHUNK_TILES - 1 - row)*BAKE_TILE_PIXELS, BAKE_TILE_PIXELS, BAKE_TILE_PIXELS}; 
+	return r; 
+}
+
+static void draw_tile(ChunkTextures *ct, Tile t, SDL_Rect *dest) {
+	if(t.tile_id <= 0 || t.tile_id > ct->sheet->tiles.size()) return; //0 for empty tile.
+	Sprite *s = &ct->sheet->tiles[t.tile_id-1]; 
+	SDL_RenderCopy(gRenderer, s->texture, &s->r, dest); 
+}
+
+//Brings ct's texture for chunk up to date. Returns false if it couldn't be created.
+static bool update_texture(ChunkTextures *ct, ChunkTexture *tex, const Chunk *chunk) {
+	if(tex->texture == NULL) {
+		tex->texture = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+											CHUNK_TEXTURE_PIXELS, CHUNK_TEXTURE_PIXELS); 
+		if(tex->texture == NULL) {
+			printf("Unable to create chunk texture! SDL Error: %s\n", SDL_GetError()); 
+			return false; 
+		}
+		SDL_SetTextureBlendMode(tex->texture, SDL_BLENDMODE_BLEND); 
+		tex->baked = false; 
+	}
+	ct->dirty.clear(); 
+	if(tex->baked) {
+		if(memcmp(tex->tiles, chunk->tiles, sizeof(tex->tiles)) == 0) {
+			return true; 
+		}
+		for (int i = 0; i < CHUNK_TILES*CHUNK_TILES; i++) {
+			if(tex->tiles[i].tile_id != chunk->tiles[i].tile_id) ct->dirty.push_back(i); 
+		}
+		if(ct->dirty.empty()) {
+			memcpy(tex->tiles, chunk->tiles, sizeof(tex->tiles)); //Only damage changed, which isn't drawn.
+			return true; 
+		}
+		//Past a quarter of the chunk a full bake is cheaper than patching.
+		if(ct->dirty.size() >= CHUNK_TILES*CHUNK_TILES / 4) {
+			tex->baked = false; 
+		}
+	}
+	Uint8 r, g, b, a; 
+	SDL_BlendMode mode; 
+	SDL_GetRenderDrawColor(gRenderer, &r, &g, &b, &a); 
+	SDL_GetRenderDrawBlendMode(gRenderer, &mode); 
+	SDL_SetRenderTarget(gRenderer, tex->texture); 
+	//Overwrite rather than blend, so cleared squares become transparent.
+	SDL_SetRenderDrawBlendMode(gRenderer, SDL_BLENDMODE_NONE); 
+	SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, 0); 
+	if(!tex->baked) {
+		SDL_RenderClear(gRenderer); 
+		for (int i = 0; i < CHUNK_TILES*CHUNK_TILES; i++) {
+			SDL_Rect dest = tile_rect(i); 
+			draw_tile(ct, chunk->tiles[i], &dest); 
+		}
+		tex->baked = true; 
+		ct->bakes += 1; 
+	} else {
+		for (int i = 0; i < ct->dirty.size(); i++) {
+			SDL_Rect dest = tile_rect(ct->dirty[i]); 
+			SDL_RenderFillRect(gRenderer, &dest); 
+			draw_tile(ct, chunk->tiles[ct->dirty[i]], &dest); 
+		}
+		ct->tile_redraws += ct->dirty.size(); 
+	}
+	memcpy(tex->tiles, chunk->tiles, sizeof(tex->tiles)); 
+	SDL_SetRenderTarget(gRenderer, NULL); 
+	SDL_SetRenderDrawBlendMode(gRenderer, mode); 
+	SDL_SetRenderDrawColor(gRenderer, r, g, b, a); 
+	return true; 
+}
+
+void render_chunk(ChunkTextures *ct, const Chunk *chunk, Camera camera) {
+	ChunkIndices c = {chunk->row, chunk->col}; 
+	auto it = ct->textures.find(c); 
+	if(it == ct->textures.end()) {
+		it = ct->textures.insert({c, ChunkTexture {NULL, false, {}, ct->frame}}).first; 
+	}
+	ChunkTexture *tex = &it->second; 
+	tex->last_drawn = ct->frame; 
+	if(!update_texture(ct, tex, chunk)) {
+		return; 
+	}
+	glm::dvec2 chunk_pos = glm::dvec2(chunk->col*CHUNK_WIDTH, chunk->row*CHUNK_WIDTH); 
+	SDL_Rect dest = toRect(chunk_pos, glm::dvec2(CHUNK_WIDTH, CHUNK_WIDTH), camera); 
+	SDL_RenderCopy(gRenderer, tex->texture, NULL, &dest); 
+}
+
+void trim_chunk_textures(ChunkTextures *ct) {
+	for (auto it = ct->textures.begin(); it != ct->textures.end();) {
+		if(ct->frame - it->second.last_drawn > CHUNK_TEXTURE_KEEP) {
+			if(it->second.texture != NULL) SDL_DestroyTexture(it->second.texture); 
+			it = ct->textures.erase(it); 
+		} else {
+			it++; 
+		}
+	}
+	ct->frame += 1; 
+}
+
+void free_chunk_textures(ChunkTextures *ct) {
+	SDL_DelEventWatch(watch_render_reset, ct); 
+	for (auto& it : ct->textures) {
+		if(it.second.texture != NULL) SDL_DestroyTexture(it.second.texture); 
+	}
+	ct->textures.clear(); 
+}
@@ -0,0 +1,47 @@
+#ifndef HEADERFILE_CHUNK_RENDER
+#define HEADERFILE_CHUNK_RENDER
+
+#include <SDL.h>
+#include <vector>
+#include <unordered_map>
+#include "chunk.hpp"
+#include "game_world.hpp"
+#include "renderer.hpp"
+
+/*
+Chunk tiles baked into one render target texture per chunk, so drawing a chunk is a single copy.
+A chunk is baked in full when first drawn or after its texture's contents are lost. After that,
+each draw compares the chunk's tiles with the copy kept from the last draw and redraws only the
+squares that changed, so edits and rollbacks need no notice. Textures not drawn for
+CHUNK_TEXTURE_KEEP frames are freed.
+*/
+
+const int BAKE_TILE_PIXELS = 32; //Tile size in baked textures. Source tiles of 128 would make 64MB chunks.
+const int CHUNK_TEXTURE_PIXELS = CHUNK_TILES * BAKE_TILE_PIXELS; 
+const uint32_t CHUNK_TEXTURE_KEEP = 600; 
+
+struct ChunkTexture {
+	SDL_Texture *texture; 
+	bool baked; //False until the whole chunk has been drawn into texture.
+	Tile tiles[CHUNK_TILES*CHUNK_TILES]; //Tiles as drawn into texture.
+	uint32_t last_drawn; 
+}; 
+
+struct ChunkTextures {
+	std::unordered_map<ChunkIndices, ChunkTexture> textures; 
+	SpriteSheet *sheet; //Source of tile images. 
+	uint32_t frame; 
+	std::vector<uint16_t> dirty; //Scratch for tile indices to redraw.
+	int bakes; //Full bakes and single tile redraws since startup.
+	int tile_redraws; 
+	ChunkTextures(SpriteSheet *sheet); 
+}; 
+
+//Draws chunk with one copy, baking or patching its texture first if needed.
+void render_chunk(ChunkTextures *ct, const Chunk *chunk, Camera camera); 
+//Frees textures not drawn recently. Call once per rendered frame.
+void trim_chunk_textures(ChunkTextures *ct); 
+//Frees every texture. Call before the renderer is destroyed.
+void free_chunk_textures(ChunkTextures *ct); 
+
+#endif
@@ -1,19 +1,373 @@
 #include "combat.hpp"
+#include "physics.hpp"
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
 
-bool checkIntersecting(Hurtbox a, Hitbox h) {
-    glm::dvec2 d = a.dim + h.dim;
-    glm::dvec2 p = a.pos - h.dim; 
-    return h.pos.x >= p.x && h.pos.x <= p.x + d.x && h.pos.y >= p.y && h.pos.y <= p.y + d.y; 
+//Boxes touching at an edge count as intersecting. 
+static inline bool checkIntersecting(float ax0, float ay0, float ax1, float ay1, 
+                                        float bx0, float by0, float bx1, float by1) {
+    return (bx1 >= ax0) & (bx0 <= ax1) & (by1 >= ay0) & (by0 <= ay1); 
 }
 
-//Identify all intersecting hurt and hit boxes and add to hits. Build a  
-void addHits(std::vector<Hurtbox> *hurtboxes, std::vector<Hitbox> *hitboxes, std::vector<Hit> *hits) {
-    for (auto a = hurtboxes->begin(); a != hurtboxes->end(); a++) {
-        for (auto h = hitboxes->begin(); h != hitboxes->end(); h++) {
-            if(checkIntersecting(*a, *h)) {
-                hits->push_back(Hit {*a, *h}); 
+CombatShape polygonShape(glm::dvec2 pos, const glm::dvec2 *vertices, int num_vertices) {
+    CombatShape s; 
+    s.radius = 0; 
+    if(num_vertices > COMBAT_SHAPE_VERTICES) {
+        //Dropping vertices would change the shape and could leave it concave, so cover the whole polygon instead. 
+        printf("WARNING: Combat polygon has %d vertices, max is %d. Using its bounding box\n", num_vertices, COMBAT_SHAPE_VERTICES); 
+        glm::dvec2 lo = vertices[0]; glm::dvec2 hi = vertices[0]; 
+        for (int i = 1; i < num_vertices; i++) {
+            lo = glm::min(lo, vertices[i]); hi = glm::max(hi, vertices[i]); 
+        }
+        s.vertices[0] = pos + lo; s.vertices[1] = pos + glm::dvec2(hi.x, lo.y); 
+        s.vertices[2] = pos + hi; s.vertices[3] = pos + glm::dvec2(lo.x, hi.y); 
+        s.num_vertices = 4; 
+        return s; 
+    }
+    s.num_vertices = num_vertices; 
+    for (int i = 0; i < s.num_vertices; i++) {
+        s.vertices[i] = pos + vertices[i]; 
+    }
+    return s; 
+}
+
+CombatShape orientedBoxShape(glm::dvec2 center, glm::dvec2 half_dim, double angle) {
+    glm::dvec2 u = glm::dvec2(cos(angle), sin(angle)) * half_dim.x; 
+    glm::dvec2 v = glm::dvec2(-sin(angle), cos(angle)) * half_dim.y; 
+    CombatShape s; 
+    s.vertices[0] = center - u - v; s.vertices[1] = center + u - v; 
+    s.vertices[2] = center + u + v; s.vertices[3] = center - u + v; 
+    s.num_vertices = 4; 
+    s.radius = 0; 
+    return s; 
+}
+
+CombatShape capsuleShape(glm::dvec2 p0, glm::dvec2 p1, double radius) {
+    CombatShape s; 
+    s.vertices[0] = p0; s.vertices[1] = p1; 
+    s.num_vertices = 2; 
+    s.radius = radius; 
+    return s; 
+}
+
+//Sets pos and dim to the bounding box of s. 
+static void shapeBounds(CombatShape *s, glm::dvec2 *pos, glm::dvec2 *dim) {
+    glm::dvec2 lo = s->vertices[0]; glm::dvec2 hi = s->vertices[0]; 
+    for (int i = 1; i < s->num_vertices; i++) {
+        lo = glm::min(lo, s->vertices[i]); hi = glm::max(hi, s->vertices[i]); 
+    }
+    *pos = lo - s->radius; 
+    *dim = hi - lo + 2 * s->radius; 
+}
+
+HurtboxBuffer::HurtboxBuffer() {
+    count = 0; 
+    reserve(COMBAT_BOX_CAPACITY); 
+}
+
+void HurtboxBuffer::reserve(int capacity) {
+    x.resize(capacity); y.resize(capacity); w.resize(capacity); h.resize(capacity); 
+    vx.resize(capacity); vy.resize(capacity); weight.resize(capacity); power.resize(capacity); 
+    owner.resize(capacity); flags.resize(capacity); attack_id.resize(capacity); lifetime.resize(capacity); 
+    shape.resize(capacity); 
+}
+
+void HurtboxBuffer::clear() {
+    count = 0; 
+    shapes.clear(); 
+}
+
+int HurtboxBuffer::push(Hurtbox b) {
+    if(count == x.size()) {
+        reserve(2*count); 
+    }
+    int i = count; 
+    x[i] = b.pos.x; y[i] = b.pos.y; w[i] = b.dim.x; h[i] = b.dim.y; 
+    vx[i] = b.vel.x; vy[i] = b.vel.y; weight[i] = b.weight; power[i] = b.power; 
+    owner[i] = b.parent_id; flags[i] = 0; attack_id[i] = b.attack_id; lifetime[i] = b.lifetime; 
+    shape[i] = -1; 
+    count += 1; 
+    return i; 
+}
+
+int HurtboxBuffer::push(Hurtbox b, CombatShape s) {
+    shapeBounds(&s, &b.pos, &b.dim); 
+    int i = push(b); 
+    shape[i] = shapes.size(); 
+    shapes.push_back(s); 
+    return i; 
+}
+
+HitboxBuffer::HitboxBuffer() {
+    count = 0; 
+    reserve(COMBAT_BOX_CAPACITY); 
+}
+
+void HitboxBuffer::reserve(int capacity) {
+    x.resize(capacity); y.resize(capacity); w.resize(capacity); h.resize(capacity); 
+    owner.resize(capacity); flags.resize(capacity); shape.resize(capacity); 
+}
+
+void HitboxBuffer::clear() {
+    count = 0; 
+    shapes.clear(); 
+}
+
+int HitboxBuffer::push(Hitbox b) {
+    if(count == x.size()) {
+        reserve(2*count); 
+    }
+    int i = count; 
+    x[i] = b.pos.x; y[i] = b.pos.y; w[i] = b.dim.x; h[i] = b.dim.y; 
+    owner[i] = b.parent_id; flags[i] = b.hitflags; 
+    shape[i] = -1; 
+    count += 1; 
+    return i; 
+}
+
+int HitboxBuffer::push(Hitbox b, CombatShape s) {
+    shapeBounds(&s, &b.pos, &b.dim); 
+    int i = push(b); 
+    shape[i] = shapes.size(); 
+    shapes.push_back(s); 
+    return i; 
+}
+
+//Shape of box i, or its corners when it has none. 
+static CombatShape boxShape(std::vector<int> *shape, std::vector<CombatShape> *shapes, 
+                                float x, float y, float w, float h, int i) {
+    if((*shape)[i] >= 0) {
+        return (*shapes)[(*shape)[i]]; 
+    }
+    CombatShape s; 
+    s.vertices[0] = glm::dvec2(x, y); s.vertices[1] = glm::dvec2(x + w, y); 
+    s.vertices[2] = glm::dvec2(x + w, y + h); s.vertices[3] = glm::dvec2(x, y + h); 
+    s.num_vertices = 4; 
+    s.radius = 0; 
+    return s; 
+}
+
+//Narrow phase for a pair whose boxes overlap. Plain box pairs pass without testing. 
+static bool shapesIntersect(HurtboxBuffer *ab, int i, HitboxBuffer *hb, int h) {
+    if(ab->shape[i] < 0 && hb->shape[h] < 0) {
+        return true; 
+    }
+    CombatShape a = boxShape(&ab->shape, &ab->shapes, ab->x[i], ab->y[i], ab->w[i], ab->h[i], i); 
+    CombatShape b = boxShape(&hb->shape, &hb->shapes, hb->x[h], hb->y[h], hb->w[h], hb->h[h], h); 
+    return convex_overlap(a.vertices, a.num_vertices, a.radius, b.vertices, b.num_vertices, b.radius); 
+}
+
+static inline int cellIndex(float x) {
+    return (int) floor(x / COMBAT_CELL_WIDTH); 
+}
+
+static inline int cellBucket(int cx, int cy) {
+    return ((uint32_t) cx * 73856093u ^ (uint32_t) cy * 19349663u) & (COMBAT_GRID_BUCKETS - 1); 
+}
+
+static inline uint32_t registrySlot(uint64_t key) {
+    return (uint32_t) ((key * 0x9E3779B97F4A7C15ull) >> 32); 
+}
+
+HitRegistry::HitRegistry() {
+    keys.assign(64, 0); 
+    expiry.assign(64, 0); 
+    mask = 63; 
+    count = 0; 
+    next_expiry = UINT32_MAX; 
+}
+
+bool HitRegistry::record(uint32_t attack_id, int target_id, uint32_t frame, uint32_t lifetime) {
+    if(attack_id == 0 || lifetime == 0) {
+        return true; //Nothing to block. A zero lifetime could also store expiry 0, the empty marker. 
+    }
+    if(2*(count + 1) > keys.size()) {
+        rehash(2*keys.size(), frame); 
+    }
+    uint64_t key = ((uint64_t) attack_id << 32) | (uint32_t) target_id; 
+    uint32_t i = registrySlot(key) & mask; 
+    while(expiry[i] != 0) {
+        if(keys[i] == key) {
+            if(expiry[i] > frame) {
+                return false; 
+            }
+            expiry[i] = frame + lifetime; //Expired but not yet cleared, reuse slot. 
+            next_expiry = std::min(next_expiry, expiry[i]); 
+            return true; 
+        }
+        i = (i + 1) & mask; 
+    }
+    keys[i] = key; 
+    expiry[i] = frame + lifetime; 
+    next_expiry = std::min(next_expiry, expiry[i]); 
+    count += 1; 
+    return true; 
+}
+
+void HitRegistry::expire(uint32_t frame) {
+    if(count > 0 && next_expiry <= frame) {
+        rehash(keys.size(), frame); 
+    }
+}
+
+//Reinserts live entries into a table of the given capacity, dropping expired ones. 
+void HitRegistry::rehash(int capacity, uint32_t frame) {
+    old_keys.swap(keys); 
+    old_expiry.swap(expiry); 
+    keys.assign(capacity, 0); 
+    expiry.assign(capacity, 0); 
+    mask = capacity - 1; 
+    count = 0; 
+    next_expiry = UINT32_MAX; 
+    for (int i = 0; i < old_keys.size(); i++) {
+        if(old_expiry[i] <= frame) {
+            continue; 
+        }
+        uint32_t j = registrySlot(old_keys[i]) & mask; 
+        while(expiry[j] != 0) {
+            j = (j + 1) & mask; 
+        }
+        keys[j] = old_keys[i]; 
+        expiry[j] = old_expiry[i]; 
+        next_expiry = std::min(next_expiry, expiry[j]); 
+        count += 1; 
+    }
+}
+
+CombatGrid::CombatGrid() {
+    bucket_start.assign(COMBAT_GRID_BUCKETS + 1, 0); 
+    items.reserve(COMBAT_BOX_CAPACITY); 
+    x0.reserve(COMBAT_BOX_CAPACITY); y0.reserve(COMBAT_BOX_CAPACITY); 
+    x1.reserve(COMBAT_BOX_CAPACITY); y1.reserve(COMBAT_BOX_CAPACITY); 
+    stamp.reserve(COMBAT_BOX_CAPACITY); 
+    candidates.reserve(COMBAT_BOX_CAPACITY); 
+}
+
+void buildCombatGrid(CombatGrid *grid, HitboxBuffer *hb) {
+    std::vector<int> *start = &grid->bucket_start; 
+    std::fill(start->begin(), start->end(), 0); 
+    //Count entries per bucket, shifted by one so the prefix sum gives start offsets. 
+    for (int i = 0; i < hb->count; i++) {
+        int cx0 = cellIndex(hb->x[i]); int cx1 = cellIndex(hb->x[i] + hb->w[i]); 
+        int cy0 = cellIndex(hb->y[i]); int cy1 = cellIndex(hb->y[i] + hb->h[i]); 
+        for (int cy = cy0; cy <= cy1; cy++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                (*start)[cellBucket(cx, cy) + 1] += 1; 
+            }
+        }
+    }
+    for (int b = 0; b < COMBAT_GRID_BUCKETS; b++) {
+        (*start)[b + 1] += (*start)[b]; 
+    }
+    int entries = start->back(); 
+    grid->items.resize(entries); 
+    grid->x0.resize(entries); grid->y0.resize(entries); 
+    grid->x1.resize(entries); grid->y1.resize(entries); 
+    grid->overlap.resize(entries); 
+    //Fill, using bucket_start as a write cursor, then shift back. 
+    for (int i = 0; i < hb->count; i++) {
+        int cx0 = cellIndex(hb->x[i]); int cx1 = cellIndex(hb->x[i] + hb->w[i]); 
+        int cy0 = cellIndex(hb->y[i]); int cy1 = cellIndex(hb->y[i] + hb->h[i]); 
+        for (int cy = cy0; cy <= cy1; cy++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                int k = (*start)[cellBucket(cx, cy)]++; 
+                grid->items[k] = i; 
+                grid->x0[k] = hb->x[i]; grid->x1[k] = hb->x[i] + hb->w[i]; 
+                grid->y0[k] = hb->y[i]; grid->y1[k] = hb->y[i] + hb->h[i]; 
+            }
+        }
+    }
+    for (int b = COMBAT_GRID_BUCKETS; b > 0; b--) {
+        (*start)[b] = (*start)[b - 1]; 
+    }
+    (*start)[0] = 0; 
+    grid->stamp.assign(hb->count, -1); 
+}
+
+//Identify all intersecting hurt and hit boxes and add to hits. Rebuilds grid from hitboxes first. 
+void addHits(HurtboxBuffer *ab, HitboxBuffer *hb, std::vector<HitPair> *hits, CombatGrid *grid, 
+                HitRegistry *registry, uint32_t frame) {
+    buildCombatGrid(grid, hb); 
+    const float *x0 = grid->x0.data(); const float *y0 = grid->y0.data(); 
+    const float *x1 = grid->x1.data(); const float *y1 = grid->y1.data(); 
+    uint8_t *overlap = grid->overlap.data(); 
+    for (int i = 0; i < ab->count; i++) {
+        float ax0 = ab->x[i]; float ax1 = ab->x[i] + ab->w[i]; 
+        float ay0 = ab->y[i]; float ay1 = ab->y[i] + ab->h[i]; 
+        grid->candidates.clear(); 
+        int cx0 = cellIndex(ax0); int cx1 = cellIndex(ax1); 
+        int cy0 = cellIndex(ay0); int cy1 = cellIndex(ay1); 
+        for (int cy = cy0; cy <= cy1; cy++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                int b = cellBucket(cx, cy); 
+                int s = grid->bucket_start[b]; int e = grid->bucket_start[b + 1]; 
+                for (int k = s; k < e; k++) { //Vectorizes 4 or 8 boxes per step. 
+                    overlap[k] = checkIntersecting(ax0, ay0, ax1, ay1, x0[k], y0[k], x1[k], y1[k]); 
+                }
+                for (int k = s; k < e; k++) {
+                    int h = grid->items[k]; 
+                    if(overlap[k] && grid->stamp[h] != i) {
+                        grid->stamp[h] = i; 
+                        grid->candidates.push_back(h); 
+                    }
+                }
+            }
+        }
+        std::sort(grid->candidates.begin(), grid->candidates.end()); //Deterministic order for hit handling. 
+        for (int k = 0; k < grid->candidates.size(); k++) {
+            int h = grid->candidates[k]; 
+            if(shapesIntersect(ab, i, hb, h) && registry->record(ab->attack_id[i], hb->owner[h], frame, ab->lifetime[i])) {
+                hits->push_back(HitPair {i, h}); 
             }
         }
     }
 }
 
+void addHitsBruteForce(HurtboxBuffer *ab, HitboxBuffer *hb, std::vector<HitPair> *hits) {
+    for (int i = 0; i < ab->count; i++) {
+        float ax0 = ab->x[i]; float ax1 = ab->x[i] + ab->w[i]; 
+        float ay0 = ab->y[i]; float ay1 = ab->y[i] + ab->h[i]; 
+        for (int h = 0; h < hb->count; h++) {
+            if(checkIntersecting(ax0, ay0, ax1, ay1, hb->x[h], hb->y[h], hb->x[h] + hb->w[h], hb->y[h] + hb->h[h]) 
+                && shapesIntersect(ab, i, hb, h)) {
+                hits->push_back(HitPair {i, h}); 
+            }
+        }
+    }
+}
+
+void sortHitEvents(HurtboxBuffer *ab, HitboxBuffer *hb, std::vector<HitPair> *hits, std::vector<HitEvent> *events) {
+    events->resize(hits->size()); 
+    for (int i = 0; i < hits->size(); i++) {
+        HitPair p = (*hits)[i]; 
+        (*events)[i] = HitEvent {hb->owner[p.hitbox], ab->owner[p.hurtbox], p.hurtbox, p.hitbox}; 
+    }
+    std::sort(events->begin(), events->end(), [](const HitEvent &a, const HitEvent &b) {
+        if(a.target_id != b.target_id) return a.target_id < b.target_id; 
+        if(a.attacker_id != b.attacker_id) return a.attacker_id < b.attacker_id; 
+        if(a.hurtbox != b.hurtbox) return a.hurtbox < b.hurtbox; 
+        return a.hitbox < b.hitbox; 
+    }); 
+}
+
+void mergeCombatDeltas(std::vector<CombatDelta> *deltas) {
+    std::sort(deltas->begin(), deltas->end(), [](const CombatDelta &a, const CombatDelta &b) {
+        if(a.entity_id != b.entity_id) return a.entity_id < b.entity_id; 
+        return a.seq < b.seq; 
+    }); 
+    int count = 0; 
+    for (int i = 0; i < deltas->size(); i++) {
+        CombatDelta d = (*deltas)[i]; 
+        if(count > 0 && (*deltas)[count - 1].entity_id == d.entity_id) {
+            CombatDelta *m = &(*deltas)[count - 1]; 
+            m->delta_v += d.delta_v; 
+            m->damage += d.damage; 
+            m->flags |= d.flags; 
+        } else {
+            (*deltas)[count] = d; 
+            count += 1; 
+        }
+    }
+    deltas->resize(count); 
+}
@@ -4,11 +4,13 @@
 #include <glm/glm.hpp>
 #include <vector>
 
+//Descriptors used to push boxes into the buffers below.
 struct Hurtbox {
-    int id;
     int parent_id;
     glm::dvec2 pos, dim, vel;
     double weight, power;
+    uint32_t attack_id; //Attack instance this box belongs to. 0 hits every tick. 
+    uint32_t lifetime; //Ticks a target stays immune to attack_id after being hit. 
 };
 
 struct Hitbox {
@@ -18,10 +20,143 @@ struct Hitbox {
     int hitflags; 
 };
 
-struct Hit {
-    Hurtbox hurtbox;
-    Hitbox hitbox; 
+const int COMBAT_SHAPE_VERTICES = 8; 
+
+/*
+Optional exact shape for a combat box, in world coordinates. Convex hull of the vertices inflated 
+by radius: 1 vertex is a circle, 2 a capsule, 3 or more a polygon. The box of a shaped entry is 
+its bounding box, so the broadphase is unchanged and only boxes that overlap test the shapes. 
+*/
+struct CombatShape {
+    glm::dvec2 vertices[COMBAT_SHAPE_VERTICES]; 
+    int num_vertices; 
+    double radius; 
+}; 
+
+//Vertices relative to pos, as in PhysicsPolygon. Polygons with more than COMBAT_SHAPE_VERTICES 
+//vertices are reported and replaced by their bounding box. 
+CombatShape polygonShape(glm::dvec2 pos, const glm::dvec2 *vertices, int num_vertices); 
+CombatShape orientedBoxShape(glm::dvec2 center, glm::dvec2 half_dim, double angle); 
+//Covers a circle of radius moving from p0 to p1, for swept tests of fast projectiles. 
+CombatShape capsuleShape(glm::dvec2 p0, glm::dvec2 p1, double radius); 
+
+const int COMBAT_BOX_CAPACITY = 1024; //Boxes reserved per buffer. Buffers only grow past this.
+
+/*
+Combat boxes as persistent structure-of-arrays buffers. Buffers are cleared each tick by
+resetting count, so refilling them doesn't allocate, and the narrow phase can run over
+contiguous float arrays. Box i of a buffer is (x[i], y[i]) to (x[i]+w[i], y[i]+h[i]).
+Shaped boxes keep their shape in a side table, so plain boxes pay nothing for them.
+*/
+struct HurtboxBuffer {
+    std::vector<float> x, y, w, h;
+    std::vector<float> vx, vy, weight, power;
+    std::vector<int> owner;
+    std::vector<uint32_t> flags;
+    std::vector<uint32_t> attack_id, lifetime;
+    std::vector<int> shape; //Index into shapes, -1 for a plain box.
+    std::vector<CombatShape> shapes; 
+    int count;
+
+    int push(Hurtbox b); //Returns index of new box.
+    int push(Hurtbox b, CombatShape s); //Box pos and dim are replaced by the shape's bounds.
+    void clear();
+    void reserve(int capacity);
+    HurtboxBuffer();
+};
+
+struct HitboxBuffer {
+    std::vector<float> x, y, w, h;
+    std::vector<int> owner;
+    std::vector<uint32_t> flags;
+    std::vector<int> shape; 
+    std::vector<CombatShape> shapes; 
+    int count;
+
+    int push(Hitbox b);
+    int push(Hitbox b, CombatShape s); 
+    void clear();
+    void reserve(int capacity);
+    HitboxBuffer();
+};
+
+//Indices of an intersecting pair in the hurtbox and hitbox buffers.
+struct HitPair {
+    int hurtbox;
+    int hitbox;
+};
+
+//One hit, keyed by the entities involved. 
+struct HitEvent {
+    int target_id; 
+    int attacker_id; 
+    int hurtbox; 
+    int hitbox; 
+}; 
+
+//Effect of hits on one entity. Merged so each entity has one delta per tick. 
+struct CombatDelta {
+    int entity_id; 
+    int seq; //Order of the source hit, so merged sums don't depend on sort stability. 
+    glm::dvec2 delta_v; 
+    double damage; 
+    uint32_t flags; 
+}; 
+
+//Scratch for the resolution stage, kept between ticks to avoid allocating. 
+struct CombatResolution {
+    std::vector<HitEvent> events; 
+    std::vector<CombatDelta> deltas; 
+}; 
+
+/*
+Set of (attack instance, target) pairs that already produced a hit, so an attack overlapping a 
+target for several ticks only hits once. Open addressing on a packed 64 bit key. An entry 
+expires `lifetime` ticks after its hit, and expired entries are dropped by expire(). 
+*/
+struct HitRegistry {
+    std::vector<uint64_t> keys; 
+    std::vector<uint32_t> expiry; //Frame an entry stops blocking. 0 marks an empty slot. 
+    std::vector<uint64_t> old_keys; //Scratch for rehashing. 
+    std::vector<uint32_t> old_expiry; 
+    uint32_t mask; 
+    int count; 
+    uint32_t next_expiry; //Earliest expiry of any entry, so expire() only rehashes once something has expired. 
+
+    //Returns true and records the pair if attack_id hasn't already hit target_id. 
+    //Attacks with attack_id or lifetime 0 always hit and are never recorded. 
+    bool record(uint32_t attack_id, int target_id, uint32_t frame, uint32_t lifetime); 
+    void expire(uint32_t frame); 
+    void rehash(int capacity, uint32_t frame); 
+    HitRegistry(); 
+}; 
+
+const double COMBAT_CELL_WIDTH = 4; //World units per broadphase cell. 
+const int COMBAT_GRID_BUCKETS = 4096; //Power of two. 
+
+/*
+Uniform grid broadphase over hitboxes, rebuilt each tick with a counting sort. Cells are hashed 
+into a fixed set of buckets so the world doesn't need bounds. Hitbox bounds are copied into
+bucket order, so the narrow phase for a bucket is one branch free pass over contiguous floats.
+*/
+struct CombatGrid {
+    std::vector<int> bucket_start; //Bucket b holds entries [bucket_start[b], bucket_start[b+1]).
+    std::vector<int> items; //Hitbox index of each entry.
+    std::vector<float> x0, y0, x1, y1; //Hitbox bounds of each entry.
+    std::vector<uint8_t> overlap; //Narrow phase results for one bucket.
+    std::vector<int> stamp; //Last hurtbox each hitbox was tested against, to skip repeats across cells. 
+    std::vector<int> candidates; 
+    CombatGrid(); 
 }; 
 
-void addHits(std::vector<Hurtbox> *, std::vector<Hitbox> *, std::vector<Hit> *); 
-#endif
\ No newline at end of file
+void buildCombatGrid(CombatGrid *grid, HitboxBuffer *hitboxes);
+//Rebuilds grid from hitboxes and appends intersecting pairs to hits, ordered by hurtbox then hitbox.
+//Pairs with a shape must also pass the shape test. Pairs already in registry are dropped before they are emitted.
+void addHits(HurtboxBuffer *, HitboxBuffer *, std::vector<HitPair> *, CombatGrid *grid,
+                HitRegistry *registry, uint32_t frame);
+void addHitsBruteForce(HurtboxBuffer *, HitboxBuffer *, std::vector<HitPair> *);
+//Fills events from hits, sorted by (target, attacker) then box indices. 
+void sortHitEvents(HurtboxBuffer *, HitboxBuffer *, std::vector<HitPair> *, std::vector<HitEvent> *events); 
+//Sorts deltas by entity and sums each entity's entries into one, in seq order. 
+void mergeCombatDeltas(std::vector<CombatDelta> *deltas); 
+#endif
@@ -0,0 +1,220 @@
+#include "flowfield.hpp"
+#include <algorithm>
+
+static const int STEP_ROW[4] = {-1, 1, 0, 0}; 
+static const int STEP_COL[4] = {0, 0, -1, 1}; 
+static const uint8_t OPPOSITE[4] = {1, 0, 3, 2}; 
+
+FlowFields::FlowFields() {
+    queue.reserve(FLOW_SIDE*FLOW_SIDE); 
+    rebuilds = 0; 
+    repairs = 0; 
+}
+
+static inline int floor_div(int a, int b) {
+    return a >= 0 ? a / b : -((-a - 1) / b) - 1; 
+}
+
+static PathTile pos_tile(glm::dvec2 p) {
+    return PathTile {(int) floor(p.y / TILE_WIDTH), (int) floor(p.x / TILE_WIDTH)}; 
+}
+
+//Index of global tile t in the window, or -1 outside it.
+static inline int field_index(FlowField *f, PathTile t) {
+    int r = t.row - f->origin.row; int c = t.col - f->origin.col; 
+    if(r < 0 || r >= FLOW_SIDE || c < 0 || c >= FLOW_SIDE) return -1; 
+    return r*FLOW_SIDE + c; 
+}
+
+//Neighbour of window tile i in direction k, or -1 past the edge.
+static inline int step(int i, int k) {
+    int r = i / FLOW_SIDE + STEP_ROW[k]; int c = i % FLOW_SIDE + STEP_COL[k]; 
+    if(r < 0 || r >= FLOW_SIDE || c < 0 || c >= FLOW_SIDE) return -1; 
+    return r*FLOW_SIDE + c; 
+}
+
+//BFS outwards from tiles already in queue, lowering dist wherever a shorter route is found.
+static void propagate(FlowField *f, std::vector<int> *queue, int head) {
+    while (head < queue->size()) {
+        int i = (*queue)[head++]; 
+        for (int k = 0; k < 4; k++) {
+            int n = step(i, k); 
+            if(n >= 0 && f->open[n] && f->dist[i] + 1 < f->dist[n]) {
+                f->dist[n] = f->dist[i] + 1; 
+                f->dir[n] = OPPOSITE[k]; 
+                queue->push_back(n); 
+            }
+        }
+    }
+}
+
+static void build_field(FlowFields *ff, FlowField *f, World *w, uint32_t frame) {
+    ff->rebuilds += 1; 
+    f->built_frame = frame; 
+    f->center = ChunkIndices {floor_div(f->target_tile.row, CHUNK_TILES), floor_div(f->target_tile.col, CHUNK_TILES)}; 
+    f->origin = PathTile {(f->center.row - FLOW_RADIUS)*CHUNK_TILES, (f->center.col - FLOW_RADIUS)*CHUNK_TILES}; 
+    f->open.assign(FLOW_SIDE*FLOW_SIDE, 0); 
+    f->dist.assign(FLOW_SIDE*FLOW_SIDE, FLOW_UNREACHED); 
+    f->dir.assign(FLOW_SIDE*FLOW_SIDE, FLOW_NO_DIR); 
+    f->missing = 0; 
+    for (int cr = 0; cr < 2*FLOW_RADIUS + 1; cr++) {
+        for (int cc = 0; cc < 2*FLOW_RADIUS + 1; cc++) {
+            Chunk *chunk = query_chunk(w, {f->center.row - FLOW_RADIUS + cr, f->center.col - FLOW_RADIUS + cc}); 
+            if(chunk == nullptr) {
+                f->missing |= 1u << (cr*(2*FLOW_RADIUS + 1) + cc); //Solid until it loads.
+                continue; 
+            }
+            for (int r = 0; r < CHUNK_TILES; r++) {
+                uint8_t *row = &f->open[(cr*CHUNK_TILES + r)*FLOW_SIDE + cc*CHUNK_TILES]; 
+                for (int c = 0; c < CHUNK_TILES; c++) {
+                    row[c] = chunk->tiles[r*CHUNK_TILES + c].tile_id == TILE_AIR; 
+                }
+            }
+        }
+    }
+    int t = field_index(f, f->target_tile); 
+    ff->queue.clear(); 
+    if(f->open[t]) {
+        f->dist[t] = 0; 
+        ff->queue.push_back(t); 
+        propagate(f, &ff->queue, 0); 
+    }
+}
+
+//True if a window chunk missing at the last build has loaded since.
+static bool missing_chunk_loaded(FlowField *f, World *w) {
+    for (int k = 0; f->missing >> k != 0; k++) {
+        if(!(f->missing >> k & 1)) continue; 
+        int cr = k / (2*FLOW_RADIUS + 1); int cc = k % (2*FLOW_RADIUS + 1); 
+        if(query_chunk(w, {f->center.row - FLOW_RADIUS + cr, f->center.col - FLOW_RADIUS + cc}) != nullptr) {
+            return true; 
+        }
+    }
+    return false; 
+}
+
+void update_flow_fields(FlowFields *ff, World *w, const FlowTarget *targets, int count, uint32_t frame) {
+    ff->fields.resize(count); 
+    for (int i = 0; i < count; i++) {
+        FlowField *f = &ff->fields[i]; 
+        PathTile t = pos_tile(targets[i].pos); 
+        ChunkIndices c = {floor_div(t.row, CHUNK_TILES), floor_div(t.col, CHUNK_TILES)}; 
+        bool moved = t.row != f->target_tile.row || t.col != f->target_tile.col; 
+        bool rebuild = f->dist.empty() || f->target_id != targets[i].entity_id || !(c == f->center) ||
+                        (moved && frame - f->built_frame >= FLOW_RETARGET_TICKS) || missing_chunk_loaded(f, w); 
+        f->target_id = targets[i].entity_id; 
+        f->target_pos = targets[i].pos; 
+        if(rebuild) {
+            f->target_tile = t; 
+            build_field(ff, f, w, frame); 
+        }
+    }
+}
+
+//Clears every tile whose route runs through a tile in ff->invalid, adding them to it.
+static void invalidate_descendants(FlowFields *ff, FlowField *f) {
+    for (int head = 0; head < ff->invalid.size(); head++) {
+        int i = ff->invalid[head]; 
+        for (int k = 0; k < 4; k++) {
+            int n = step(i, k); 
+            if(n >= 0 && f->dir[n] == OPPOSITE[k] && f->dist[n] != FLOW_UNREACHED) {
+                f->dist[n] = FLOW_UNREACHED; 
+                f->dir[n] = FLOW_NO_DIR; 
+                ff->invalid.push_back(n); 
+            }
+        }
+    }
+}
+
+static void repair_field(FlowFields *ff, FlowField *f, World *w, const TileEdit *edits, int count) {
+    ff->invalid.clear(); 
+    int target = field_index(f, f->target_tile); 
+    for (int e = 0; e < count; e++) {
+        PathTile t = {edits[e].chunk_row*CHUNK_TILES + edits[e].index / CHUNK_TILES,
+                        edits[e].chunk_col*CHUNK_TILES + edits[e].index % CHUNK_TILES}; 
+        int i = field_index(f, t); 
+        if(i < 0) continue; 
+        BlockIndices b = {edits[e].index / CHUNK_TILES, edits[e].index % CHUNK_TILES, edits[e].chunk_row, edits[e].chunk_col}; 
+        f->open[i] = query_tile(w, b).tile_id == TILE_AIR; 
+        if(i == target) {
+            build_field(ff, f, w, f->built_frame); //Target tile itself changed.
+            return; 
+        }
+        if(f->dist[i] != FLOW_UNREACHED || f->open[i]) {
+            f->dist[i] = FLOW_UNREACHED; 
+            f->dir[i] = FLOW_NO_DIR; 
+            ff->invalid.push_back(i); 
+        }
+    }
+    if(ff->invalid.empty()) return; 
+    ff->repairs += 1; 
+    invalidate_descendants(ff, f); 
+
+    //Reseed cleared tiles from valid neighbours, nearest first, then spread as in a build.
+    ff->seeds.clear(); 
+    for (int k = 0; k < ff->invalid.size(); k++) {
+        int i = ff->invalid[k]; 
+        if(!f->open[i]) continue; 
+        for (int d = 0; d < 4; d++) {
+            int n = step(i, d); 
+            if(n >= 0 && f->dist[n] != FLOW_UNREACHED && f->dist[n] + 1 < f->dist[i]) {
+                f->dist[i] = f->dist[n] + 1; 
+                f->dir[i] = d; 
+            }
+        }
+        if(f->dist[i] != FLOW_UNREACHED) {
+            ff->seeds.push_back({f->dist[i], i}); 
+        }
+    }
+    //Seeds sorted by distance make the BFS below expand in distance order, as Dijkstra would.
+    std::sort(ff->seeds.begin(), ff->seeds.end()); 
+    ff->queue.clear(); 
+    int head = 0; 
+    for (int k = 0; k < ff->seeds.size(); k++) {
+        //Expand queued tiles up to this seed's distance before adding it.
+        while (head < ff->queue.size() && f->dist[ff->queue[head]] < ff->seeds[k].first) {
+            int i = ff->queue[head++]; 
+            for (int d = 0; d < 4; d++) {
+                int n = step(i, d); 
+                if(n >= 0 && f->open[n] && f->dist[i] + 1 < f->dist[n]) {
+                    f->dist[n] = f->dist[i] + 1; 
+                    f->dir[n] = OPPOSITE[d]; 
+                    ff->queue.push_back(n); 
+                }
+            }
+        }
+        if(f->dist[ff->seeds[k].second] == ff->seeds[k].first) {
+            ff->queue.push_back(ff->seeds[k].second); 
+        }
+    }
+    propagate(f, &ff->queue, head); 
+}
+
+void flow_tiles_changed(FlowFields *ff, World *w, const TileEdit *edits, int count) {
+    if(count == 0) return; 
+    for (int i = 0; i < ff->fields.size(); i++) {
+        repair_field(ff, &ff->fields[i], w, edits, count); 
+    }
+}
+
+FlowField* nearest_flow_field(FlowFields *ff, glm::dvec2 p) {
+    FlowField *best = nullptr; 
+    double best_d2 = INFINITY; 
+    for (int i = 0; i < ff->fields.size(); i++) {
+        glm::dvec2 d = ff->fields[i].target_pos - p; 
+        if(glm::dot(d, d) < best_d2) {
+            best_d2 = glm::dot(d, d); 
+            best = &ff->fields[i]; 
+        }
+    }
+    return best; 
+}
+
+bool sample_flow(FlowField *f, glm::dvec2 p, glm::dvec2 *dir) {
+    int i = field_index(f, pos_tile(p)); 
+    if(i < 0 || f->dir[i] == FLOW_NO_DIR) {
+        return false; 
+    }
+    *dir = glm::dvec2(STEP_COL[f->dir[i]], STEP_ROW[f->dir[i]]);
+    return true; 
+}
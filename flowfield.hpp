@@ -0,0 +1,68 @@
+#ifndef HEADERFILE_FLOWFIELD
+#define HEADERFILE_FLOWFIELD
+
+#include <vector>
+#include "terrain.hpp"
+#include "pathfinding.hpp"
+
+/*
+Flow fields toward targets, shared by every agent homing on the same target. A field holds the
+4-connected distance from each air tile to the target tile, over a square of chunks around the
+target, and the direction of the next step. Sampling is one lookup, so any number of agents
+can steer from one field.
+
+A field rebuilds when its target leaves the window's center chunk, or changes tile once
+FLOW_RETARGET_TICKS have passed, or when a chunk of its window that wasn't loaded at the build
+loads. Tile edits only redo the part of the field they affect: tiles
+whose route ran through an edited tile are cleared, reseeded from their neighbours and the
+change is propagated outwards.
+*/
+
+const int FLOW_RADIUS = 2; //Chunks from the target's chunk to the window's edge.
+const int FLOW_SIDE = (2*FLOW_RADIUS + 1)*CHUNK_TILES; //Tiles per side of the window.
+const int FLOW_RETARGET_TICKS = 4; //Minimum ticks between rebuilds for a target moving within its chunk.
+const uint16_t FLOW_UNREACHED = 0xFFFF; 
+const uint8_t FLOW_NO_DIR = 4; 
+static_assert((2*FLOW_RADIUS + 1)*(2*FLOW_RADIUS + 1) <= 32, "FlowField::missing holds one bit per window chunk"); 
+
+struct FlowTarget {
+	int entity_id; 
+	glm::dvec2 pos; 
+}; 
+
+struct FlowField {
+	int target_id; //Entity the field leads to.
+	glm::dvec2 target_pos; 
+	PathTile target_tile; 
+	ChunkIndices center; //Chunk the window is centered on.
+	PathTile origin; //Top left tile of the window.
+	uint32_t built_frame; 
+	uint32_t missing; //Bit cr*(2*FLOW_RADIUS+1) + cc set for each window chunk not loaded at the build.
+	std::vector<uint8_t> open; //Air tiles in loaded chunks.
+	std::vector<uint16_t> dist; //Steps to target, FLOW_UNREACHED if none.
+	std::vector<uint8_t> dir; //Neighbour one step closer: 0 up, 1 down, 2 left, 3 right, FLOW_NO_DIR if none.
+}; 
+
+//Every live field, and scratch for updating them.
+struct FlowFields {
+	std::vector<FlowField> fields; 
+	std::vector<int> queue; 
+	std::vector<int> invalid; 
+	std::vector<std::pair<int, int>> seeds; //(dist, tile) for reseeding, sorted by dist.
+	int rebuilds; 
+	int repairs; 
+	FlowFields(); 
+}; 
+
+//Keeps fields[i] leading to targets[i], rebuilding any whose target moved. Call once per tick.
+void update_flow_fields(FlowFields *ff, World *w, const FlowTarget *targets, int count, uint32_t frame); 
+//Repairs fields after edits were applied or rolled back, e.g. the last count entries of journal.edits
+//after apply_tile_edits returns count. Reads the tiles' current state from w.
+void flow_tiles_changed(FlowFields *ff, World *w, const TileEdit *edits, int count); 
+//Field whose target is closest to p, or null.
+FlowField* nearest_flow_field(FlowFields *ff, glm::dvec2 p); 
+//Unit direction from p toward the next tile on the way to the target. False if p is outside the
+//field, can't reach the target, or is on the target's tile.
+bool sample_flow(FlowField *f, glm::dvec2 p, glm::dvec2 *dir); 
+
+#endif
@@ -1,6 +1,7 @@
 #include "game_world.hpp"
 #include "particle.hpp"
 #include "renderer.hpp"
+#include <algorithm>
 
 bool box_intersect(glm::dvec2 p1, glm::dvec2 d1, glm::dvec2 p2, glm::dvec2 d2) {
 	p2 -= p1;
@@ -32,6 +33,11 @@ SDL_Rect toRect(glm::dvec2 p, glm::dvec2 d, Camera c) {
 	return r; 
 }
 
+void cameraBounds(Camera c, glm::dvec2 *lo, glm::dvec2 *hi) {
+	*lo = toPoint(SDL_Point {0, c.SCREEN_HEIGHT}, c); 
+	*hi = toPoint(SDL_Point {c.SCREEN_WIDTH, 0}, c); 
+}
+
 void updateInputs(InputState new_inp, PlayerData *p) {
 	p->prev_inp = p->inp; 
 	p->inp = new_inp; 
@@ -92,6 +98,7 @@ RollbackECS::RollbackECS(int rollback_window) {
 	health_map.assign(MAX_ENTITIES, -1); 
 	entity_map.assign(MAX_ENTITIES, -1); 
 	ai_map.assign(MAX_ENTITIES, -1); 
+	ai_type_start.assign(AI_TYPE_COUNT + 1, 0); 
 
 	for (int i = 0; i < rollback_window; i++) {
 		r.push_back(RollbackStorage()); 
@@ -167,16 +174,28 @@ void RollbackECS::save_update(RollbackStorage *s) {
 		}
 	}
 	player_data.resize(count); 
-	count = 0; 
+	//Compact ai_data grouped by type, keeping order within a type. Counting sort on type. 
+	std::fill(ai_type_start.begin(), ai_type_start.end(), 0); 
 	for (int i = 0; i < s->ai_data.size(); i++) {
 		AIData e = s->ai_data[i]; 
 		if(ai_map[e.entity_id] == i) {
-			ai_data[count] = e;
-			ai_map[e.entity_id] = count; 
-			count += 1; 
+			ai_type_start[ai_type_slot(e.type) + 1] += 1; 
+		}
+	}
+	for (int t = 0; t < AI_TYPE_COUNT; t++) {
+		ai_type_start[t+1] += ai_type_start[t]; 
+	}
+	int ai_cursor[AI_TYPE_COUNT]; 
+	std::copy(ai_type_start.begin(), ai_type_start.begin() + AI_TYPE_COUNT, ai_cursor); 
+	for (int i = 0; i < s->ai_data.size(); i++) {
+		AIData e = s->ai_data[i]; 
+		if(ai_map[e.entity_id] == i) {
+			int k = ai_cursor[ai_type_slot(e.type)]++; 
+			ai_data[k] = e; 
+			ai_map[e.entity_id] = k; 
 		}
 	}
-	ai_data.resize(count); 
+	ai_data.resize(ai_type_start[AI_TYPE_COUNT]); 
 	count = 0; 
 	for (int i = 0; i < s->health_data.size(); i++) {
 		HealthData e = s->health_data[i]; 
@@ -200,6 +219,9 @@ int RollbackECS::push_npc() {
 
 	AIData a; 
 	a.entity_id = p_id; 
+	a.type = 0; 
+	a.flags = 0; 
+	a.last_tick = 0; 
 	ai_map[p_id] = ai_data.size(); 
 	ai_data.push_back(a); 
 
@@ -228,6 +250,7 @@ int RollbackECS::push_firefly(glm::dvec2 p) {
 	d->max_health = 100; d->health = 100; d->health_regen = 0; d->buffer_health = 0; d->buffer_regen = 0; 
 	AIData *ad = &ai_data[ai_map[fb_id]]; 
 	ad->type = FIREFLY;
+	ad->data.fb.tracking = true; ad->data.fb.power = 1; 
 	return fb_id; 
 }
 
@@ -248,7 +271,7 @@ int RollbackECS::push_fireball(glm::dvec2 p, glm::dvec2 v) {
 	AIData *ad = &ai_data[ai_map[fb_id]]; 
 	ad->type = FIREBALL; 
 	FireballAI *fba = &ai_data[ai_map[fb_id]].data.fa; 
-	fba->lifespan = 25; fba->power = 1; fba->tracking = false; fba->step = 0; 
+	fba->lifespan = 25; fba->power = 1; fba->tracking = false; fba->step = 0; fba->attack_id = 0; 
 	return fb_id; 
 }
 
@@ -258,6 +281,7 @@ int RollbackECS::push_player() {
 	PlayerData p = init_player_data(); 
 	p.entity_id = p_id; 
 	p.fire_cooldown = 0; 
+	p.attack_id = 0; 
 	player_map[p_id] = player_data.size(); 
 	player_data.push_back(p); 
 
@@ -285,11 +309,61 @@ int RollbackECS::push_player() {
 	return p_id; 
 }
 
-Gamestate::Gamestate(SpriteSheet *s, std::vector<Particle> *p) {
+Gamestate::Gamestate(SpriteSheet *s, ParticleSystem *p) {
 	ecs = new RollbackECS(16); 
 	sprite_sheet = s; 
+	sprites.body = s->getSpriteHandle("player_dot"); 
+	sprites.jump_cloud = s->getSpriteHandle("jump_cloud"); 
+	sprites.jump_flash = s->getSpriteHandle("jump_flash"); 
 	particles = p; 
-	memset(&main_chunk, 0, sizeof(Chunk));
+	frame = 0; 
+	next_attack_id = 1; //0 is reserved for boxes that skip the hit registry. 
+	world = new World; 
+	world->journal.window = ecs->r.size(); //Tile edits roll back as far as components do. 
+	main_chunk = new Chunk; 
+	memset(main_chunk, 0, sizeof(Chunk)); 
+	world->chunks.insert({0, 0}, main_chunk); 
+	pathfinder = new Pathfinder; 
+}
+
+/*
+Applies this tick's hits. Every impulse is computed from velocities before any hit is applied, 
+then deltas are merged per entity and applied in one pass, so the result doesn't depend on 
+the order hits were detected in. 
+*/
+void resolve_hits(Gamestate *g) {
+	RollbackECS *ecs = g->ecs; 
+	HurtboxBuffer *hurtboxes = &g->hurtboxes; 
+	CombatResolution *r = &g->combat_resolution; 
+	sortHitEvents(hurtboxes, &g->hitboxes, &g->hits, &r->events); 
+	r->deltas.clear(); 
+	for (int i = 0; i < r->events.size(); i++) {
+		HitEvent ev = r->events[i]; 
+		if(ecs->entity_map[ev.target_id] < 0 || ecs->entity_map[ev.attacker_id] < 0) {
+			continue; //Deleted earlier this tick. 
+		}
+		Entity *t = &ecs->entities[ecs->entity_map[ev.target_id]]; 
+		Entity *a = &ecs->entities[ecs->entity_map[ev.attacker_id]]; 
+
+		glm::dvec2 hurt_vel = glm::dvec2(hurtboxes->vx[ev.hurtbox], hurtboxes->vy[ev.hurtbox]); 
+		glm::dvec2 hit_vel = a->vel + hurt_vel - t->vel; 
+		glm::dvec2 delta_v = hit_vel * (double) hurtboxes->weight[ev.hurtbox] / t->mass; 
+		r->deltas.push_back(CombatDelta {ev.target_id, 2*i, delta_v, hurtboxes->power[ev.hurtbox], TARGET_HIT}); 
+		r->deltas.push_back(CombatDelta {ev.attacker_id, 2*i + 1, -delta_v, 0, ATTACKER_HIT}); 
+	}
+	mergeCombatDeltas(&r->deltas); 
+
+	for (int i = 0; i < r->deltas.size(); i++) {
+		CombatDelta d = r->deltas[i]; 
+		Entity *e = &ecs->entities[ecs->entity_map[d.entity_id]]; 
+		e->vel += d.delta_v; 
+		e->flags = e->flags | d.flags; 
+		if(d.damage > 0 && ecs->health_map[d.entity_id] >= 0) {
+			HealthData *h = &ecs->health_data[ecs->health_map[d.entity_id]]; 
+			h->health = h->health - d.damage; 
+			printf("handled hit, new target health %d\n", h->health); 
+		}
+	}
 }
 
 PlayerData init_player_data() {
@@ -433,21 +507,20 @@ void player_physics_update(PhysicsPolygon *poly, PlayerData *p, Gamestate *g) {
 	if(s != e) {
 		if(e == MovementState::AIR_JUMP) {
 			glm::dvec2 cv = glm::dvec2(-0.05*p->inp.x, 0.2*std::min(-poly->vel.y, 0.0)); 
-			Particle jump_cloud = {pos: poly->pos - glm::dvec2(1, 1), vel: cv, 
-									dim: glm::dvec2(1, 1), s: g->sprite_sheet->getSpriteEntry("jump_cloud"),
-									timestep: 0,
-									change_interval: 8,
+			ParticleBurst jump_cloud = {pos: poly->pos - glm::dvec2(1, 1), vel: cv, spread: glm::dvec2(0, 0), 
+									dim: glm::dvec2(1, 1), sprite: g->sprites.jump_cloud,
+									count: 1,
 									lifetime: 23,
+									change_interval: 8,
 									gravity: false
 			};
-			g->particles->push_back(jump_cloud); 
+			emit_burst(g->particles, &jump_cloud, g->frame); 
 		}  else if (e == MovementState::GROUND_JUMP) {
-			Particle jump_flash = {pos: poly->pos - glm::dvec2(1, 1), vel: glm::dvec2(0, 0), 
-									dim: glm::dvec2(1, 1), s: g->sprite_sheet->getSpriteEntry("jump_flash"),
-									timestep: 0,
-									change_interval: 1,
-									lifetime: 16, gravity: false };
-			g->particles->push_back(jump_flash); 
+			ParticleBurst jump_flash = {pos: poly->pos - glm::dvec2(1, 1), vel: glm::dvec2(0, 0), spread: glm::dvec2(0, 0), 
+									dim: glm::dvec2(1, 1), sprite: g->sprites.jump_flash,
+									count: 1,
+									lifetime: 16, change_interval: 1, gravity: false }; 
+			emit_burst(g->particles, &jump_flash, g->frame); 
 		}
 	}
 }
\ No newline at end of file
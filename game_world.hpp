@@ -10,12 +10,13 @@
 #include "particle.hpp"
 #include "renderer.hpp"
 #include "combat.hpp"
+#include "terrain.hpp"
+#include "pathfinding.hpp"
+#include "flowfield.hpp"
+#include "spatial.hpp"
 
 
 const int TILE_PIXELS = 128; 
-const double TILE_WIDTH = 1; 
-const int CHUNK_TILES = 32; 
-const double CHUNK_WIDTH = TILE_WIDTH * CHUNK_TILES; 
 const double COLLISION_BUFFER = 1e-2; //Collisions happen 1e-2 from surface. 
 const double CONTACT_BUFFER = 2e-2; //Contacts are maintained when within 2e-2 of surface. 
 
@@ -24,28 +25,6 @@ const double GROUND_ACC = 0.04;
 const double GROUND_JUMP_VEL = 0.15; 
 const double AIR_JUMP_VEL = 0.2; 
 
-struct Tile {
-   char tile_id;
-   char damage; 
-};
-
-struct Chunk {
-	int row;
-	int col; 
-	Tile tiles[CHUNK_TILES*CHUNK_TILES];
-}; 
-
-struct BlockIndices {
-	int row, col; 
-	int chunk_row, chunk_col; 
-}; 
-
-bool operator==(const BlockIndices b1, const BlockIndices b2); 
-
-enum ContactSide {
-	LEFT=0, RIGHT, TOP, BOTTOM
-}; 
-
 struct Collision {
     glm::dvec2 pos, norm;
 	ContactSide s; 
@@ -60,6 +39,13 @@ struct TileContact {
 	bool valid; 
 }; 
 
+//Sprites gameplay code draws or spawns, resolved by name once when the Gamestate is created. 
+struct GameSprites {
+	SpriteHandle body; 
+	SpriteHandle jump_cloud; 
+	SpriteHandle jump_flash; 
+}; 
+
 struct Entity {
 	uint32_t entity_id; //For reference in hashmaps, etc. 
 	glm::dvec2 pos; 
@@ -72,6 +58,9 @@ struct Entity {
 	int operator_index; 
 	uint32_t flags; 
 	bool deleted; 
+	SpriteHandle sprite = SPRITE_NONE; //SPRITE_NONE draws the default body sprite. 
+	glm::dvec2 prev_pos; //Position at the start of tick prev_frame, for interpolated rendering. 
+	uint32_t prev_frame = UINT32_MAX; 
 }; 
 
 static const uint32_t COLLIDE_TILES = 1; 
@@ -115,6 +104,12 @@ static const uint32_t HUNTER = 5;
 static const uint32_t CANNON = 6; 
 static const uint32_t NEEDLEWORKER = 7; 
 static const uint32_t SANDBOXER = 8; 
+static const int AI_TYPE_COUNT = 9; //One past the largest type. 
+
+//Group index of an AI type. Unknown types share group 0 and get no behavior. 
+static inline int ai_type_slot(uint32_t type) {
+	return type < AI_TYPE_COUNT ? type : 0; 
+}
 
 
 struct FireballAI {
@@ -122,6 +117,7 @@ struct FireballAI {
 	int power; 
 	int step; 
 	int lifespan; 
+	uint32_t attack_id; 
 }; 
 
 struct FireflyAI {
@@ -144,6 +140,7 @@ struct AIData {
 	int entity_id; //Index of entity in gamestate.entities
 	uint32_t type; 
 	uint32_t flags; 
+	uint32_t last_tick; //Frame of the last update. Kernels catch up on the ticks since. 
 	InternalAI data; 
 };
 
@@ -156,6 +153,7 @@ struct PlayerData {
 	bool contact_sides[4]; 
 	int timestep; //Timestep starting from last state change. 
 	int fire_cooldown; 
+	uint32_t attack_id; //Current melee attack instance, renewed on each press. 
 };
 PlayerData init_player_data(); 
 
@@ -177,6 +175,7 @@ Rules for ECS
 */
 
 const int MAX_ENTITIES = 2048; 
+const int PLAYER_ATTACK_LIFETIME = 20; //Ticks before a held melee attack can hit the same target again. 
 
 struct RollbackStorage {
 	std::vector<int> ids; 
@@ -199,6 +198,9 @@ struct RollbackECS {
 	std::vector<PlayerData> player_data; 
 	std::vector<HealthData> health_data; 
 	std::vector<AIData> ai_data; 
+	//After save_update, ai_data[ai_type_start[t], ai_type_start[t+1]) holds AI type t. Entries 
+	//from ai_type_start[AI_TYPE_COUNT] on were pushed since, in any order. 
+	std::vector<int> ai_type_start; 
 
 	std::vector<int> free_ids; //Ids freed by deletion. 
 
@@ -217,21 +219,50 @@ struct RollbackECS {
 	RollbackECS(int rollback_window); 
 }; 
 
-struct Gamestate {
-	RollbackECS *ecs; 
-	std::vector<Hitbox> hitboxes;
-	std::vector<Hurtbox> hurtboxes; 
-	std::vector<Hit> hits; 
+enum AILod {
+	AI_LOD_NEAR, AI_LOD_MID, AI_LOD_DORMANT
+}; 
 
-	Chunk main_chunk;
+const double AI_NEAR_DISTANCE = 32; //Within this of a player, AI updates every tick. 
+const double AI_FAR_DISTANCE = 96; //Beyond this, AI is dormant. 
+const int AI_MID_PERIOD = 4; //Mid range AI updates every AI_MID_PERIOD ticks. 
 
-	std::vector<Particle> *particles; 
+//ai_data entries to update this tick, grouped by type. Rebuilt by schedule_ai every tick. 
+struct AISchedule {
+	std::vector<int> indices; 
+	int type_start[AI_TYPE_COUNT + 1]; //Type t is indices[type_start[t], type_start[t+1]). 
+	int lod_count[3]; //Entries in each AILod band last tick. 
+}; 
+
+struct Gamestate {
+	RollbackECS *ecs; 
+	HitboxBuffer hitboxes; 
+	HurtboxBuffer hurtboxes; 
+	std::vector<HitPair> hits; 
+	CombatResolution combat_resolution; 
+	CombatGrid combat_grid; 
+	HitRegistry hit_registry; 
+	uint32_t next_attack_id; 
+	AISchedule ai_schedule; 
+	SpatialIndex entity_index; //Entity centers, updated after tile physics. 
+
+	World *world; 
+	Pathfinder *pathfinder; 
+	FlowFields flow_fields; //One per player, for homing AI. 
+	std::vector<FlowTarget> flow_targets; 
+	Chunk *main_chunk; //Chunk (0, 0), the only chunk physics uses so far. Pinned every tick so the cache never evicts it. 
+	uint32_t frame; //Simulation tick, used to tag tile edits for rollback. 
+
+	ParticleSystem *particles; 
 	SpriteSheet *sprite_sheet; 
-	Gamestate(SpriteSheet *sheet, std::vector<Particle> *p);
+	GameSprites sprites; 
+	Gamestate(SpriteSheet *sheet, ParticleSystem *p); 
 }; 
 
 void updateInputs(InputState new_inp, PlayerData *p); 
 void player_physics_update(Entity *e, PlayerData *p, Gamestate *g); 
+//Sorts, merges and applies gamestate.hits to velocities, flags and health. 
+void resolve_hits(Gamestate *g); 
 
 bool box_intersect(glm::dvec2 p1, glm::dvec2 d1, glm::dvec2 p2, glm::dvec2 d2); 
 
@@ -241,12 +272,20 @@ glm::dvec2 toPoint(SDL_Point p, Camera c);
 
 //Converts a rectangle in units to a pixel rectangle in the camera. 
 SDL_Rect toRect(glm::dvec2 p, glm::dvec2 d, Camera c);
-
-//Adds a list of all squares intersecting a line segment to a vector. 
-void listIntersectingSquares(glm::dvec2 s, glm::dvec2 e, std::vector<BlockIndices> *l); 
-//Adds a list of the squares neighboring s. (Nine total with square containing s included.). 
-void listNeighborSquares(glm::dvec2 s, std::vector<BlockIndices> *l); 
-void listTileNeighborSquares(BlockIndices t, std::vector<BlockIndices> *l); 
+//World space rectangle [lo, hi] shown by the camera. 
+void cameraBounds(Camera c, glm::dvec2 *lo, glm::dvec2 *hi); 
+//True if the box at p with dimensions d overlaps [lo, hi]. 
+inline bool boxInView(glm::dvec2 lo, glm::dvec2 hi, glm::dvec2 p, glm::dvec2 d) {
+	return p.x <= hi.x && p.y <= hi.y && p.x + d.x >= lo.x && p.y + d.y >= lo.y; 
+}
+
+//Where to draw e, alpha of the way from its position a tick ago to its current one. 
+//frame is the number of ticks run so far. Entities spawned during the last tick have no 
+//earlier position, so they're drawn where they are. 
+inline glm::dvec2 renderPos(const Entity *e, uint32_t frame, double alpha) {
+	if(e->prev_frame != frame - 1) return e->pos; 
+	return glm::mix(e->prev_pos, e->pos, alpha); 
+}
 
 //Returns a collusion object for the collusion between a tile and a moving box. 
 Collision getTileBoxCollision(BlockIndices b, glm::dvec2 p1, glm::dvec2 p2, glm::dvec2 d); 
@@ -55,4 +55,11 @@ InputState getSDLInputs(InputState curr_input) {
         }
     }
     return curr_input; 
-}
\ No newline at end of file
+}
+
+InputState latchInputs(InputState latched, InputState next) {
+    next.mouse_down = next.mouse_down || latched.mouse_down; 
+    next.right_mouse_down = next.right_mouse_down || latched.right_mouse_down; 
+    next.j = next.j || latched.j; 
+    return next; 
+}
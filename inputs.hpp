@@ -17,5 +17,7 @@ struct InputState {
 }; 
 
 InputState getSDLInputs(InputState s);
+//next, with any button held in latched also held, so a press survives until it's been read. 
+InputState latchInputs(InputState latched, InputState next); 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "particle.hpp"
+#include <algorithm>
+
+ParticleSystem::ParticleSystem(int capacity) {
+	count = 0; 
+	dropped = 0; 
+	this->capacity = capacity; 
+	x.resize(capacity); y.resize(capacity); 
+	prev_x.resize(capacity); prev_y.resize(capacity); 
+	vx.resize(capacity); vy.resize(capacity); 
+	w.resize(capacity); h.resize(capacity); 
+	gravity.resize(capacity); 
+	age.resize(capacity); 
+	lifetime.resize(capacity); 
+	change_interval.resize(capacity); 
+	sprite.resize(capacity); 
+}
+
+//Uniform in [-1, 1) from a hash of seed and i. 
+static float burst_noise(uint32_t seed, uint32_t i) {
+	uint32_t h = seed * 0x9E3779B1u ^ i * 0x85EBCA77u; 
+	h ^= h >> 15; h *= 0x2C1B3C6Du; 
+	h ^= h >> 12; h *= 0x297A2D39u; 
+	h ^= h >> 15; 
+	return (h >> 8) * (2.0f / 16777216.0f) - 1.0f; 
+}
+
+int emit_burst(ParticleSystem *ps, const ParticleBurst *b, uint32_t seed) {
+	int n = std::min(b->count, ps->capacity - ps->count); 
+	ps->dropped += b->count - n; 
+	for (int k = 0; k < n; k++) {
+		int i = ps->count + k; 
+		ps->x[i] = ps->prev_x[i] = b->pos.x; 
+		ps->y[i] = ps->prev_y[i] = b->pos.y; 
+		ps->vx[i] = b->vel.x + b->spread.x * burst_noise(seed, 2*k); 
+		ps->vy[i] = b->vel.y + b->spread.y * burst_noise(seed, 2*k + 1); 
+		ps->w[i] = b->dim.x; 
+		ps->h[i] = b->dim.y; 
+		ps->gravity[i] = b->gravity ? PARTICLE_GRAVITY : 0; 
+		ps->age[i] = 0; 
+		ps->lifetime[i] = b->lifetime; 
+		ps->change_interval[i] = std::max(b->change_interval, 1); 
+		ps->sprite[i] = b->sprite; 
+	}
+	ps->count += n; 
+	return n; 
+}
+
+//Copies particle from into slot to. 
+static void move_particle(ParticleSystem *ps, int to, int from) {
+	ps->x[to] = ps->x[from]; ps->y[to] = ps->y[from]; 
+	ps->prev_x[to] = ps->prev_x[from]; ps->prev_y[to] = ps->prev_y[from]; 
+	ps->vx[to] = ps->vx[from]; ps->vy[to] = ps->vy[from]; 
+	ps->w[to] = ps->w[from]; ps->h[to] = ps->h[from]; 
+	ps->gravity[to] = ps->gravity[from]; 
+	ps->age[to] = ps->age[from]; 
+	ps->lifetime[to] = ps->lifetime[from]; 
+	ps->change_interval[to] = ps->change_interval[from]; 
+	ps->sprite[to] = ps->sprite[from]; 
+}
+
+//Moves n particles one tick. Branch free, and the arrays don't overlap, so the loop vectorizes. 
+static void integrate_strip(float* __restrict x, float* __restrict y, float* __restrict prev_x, float* __restrict prev_y, 
+							const float* __restrict vx, float* __restrict vy, const float* __restrict gravity, int n) {
+	for (int i = 0; i < n; i++) {
+		prev_x[i] = x[i]; 
+		prev_y[i] = y[i]; 
+		x[i] += vx[i]; 
+		y[i] += vy[i]; 
+		vy[i] -= gravity[i]; //Gravity only pulls on y. 
+	}
+}
+
+void update_particles(ParticleSystem *ps) {
+	integrate_strip(ps->x.data(), ps->y.data(), ps->prev_x.data(), ps->prev_y.data(), 
+					ps->vx.data(), ps->vy.data(), ps->gravity.data(), ps->count); 
+	uint16_t *age = ps->age.data(); 
+	for (int i = 0; i < ps->count; i++) {
+		age[i] += 1; 
+	}
+	//Swap the last live particle into each expired one's slot. The slot is checked again, 
+	//since the particle moved in may have expired too. 
+	for (int i = 0; i < ps->count;) {
+		if(ps->age[i] >= ps->lifetime[i]) {
+			ps->count -= 1; 
+			move_particle(ps, i, ps->count); 
+		} else {
+			i++; 
+		}
+	}
+}
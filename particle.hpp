@@ -1,18 +1,52 @@
 #ifndef HEADERFILE_PARTICLE
 #define HEADERFILE_PARTICLE
 
+#include <stdint.h>
+#include <vector>
 #include <glm/glm.hpp>
 #include "renderer.hpp"
 
-struct Particle {
-	glm::dvec2 pos;
+const int PARTICLE_CAPACITY = 131072; 
+const float PARTICLE_GRAVITY = 0.02f; //Downward acceleration, units per tick per tick. 
+
+/*
+Fixed capacity pool of particles, one array per field. The first count entries are live. Dead
+particles are swap-removed, so live ones stay packed and updates are straight loops over
+arrays that the compiler vectorizes. Positions are floats, plenty for effects that live a
+second. Spawns past capacity are dropped and counted.
+*/
+struct ParticleSystem {
+	int count; 
+	int capacity; 
+	int dropped; 
+	std::vector<float> x, y; 
+	std::vector<float> prev_x, prev_y; //Position a tick ago, for interpolated rendering. 
+	std::vector<float> vx, vy; 
+	std::vector<float> w, h; 
+	std::vector<float> gravity; //PARTICLE_GRAVITY or 0, so falling needs no branch. 
+	std::vector<uint16_t> age; //Ticks since spawning. 
+	std::vector<uint16_t> lifetime; 
+	std::vector<uint16_t> change_interval; //Ticks per animation frame. 
+	std::vector<SpriteHandle> sprite; 
+	ParticleSystem(int capacity); 
+}; 
+
+//Spawns count particles at once at pos, each with vel plus a random offset within +-spread. 
+struct ParticleBurst {
+	glm::dvec2 pos; 
 	glm::dvec2 vel; 
+	glm::dvec2 spread; 
 	glm::dvec2 dim; 
-	Sprite s; 
-	int timestep; //Timestep starting from creation. 
-	int change_interval; 
+	SpriteHandle sprite; 
+	int count; 
 	int lifetime; 
+	int change_interval; 
 	bool gravity; 
-};
+}; 
+
+//Returns the number spawned. seed picks the offsets, so a burst is the same every replay. 
+int emit_burst(ParticleSystem *ps, const ParticleBurst *b, uint32_t seed); 
+//Moves every particle one tick, then removes those past their lifetime. 
+void update_particles(ParticleSystem *ps); 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,429 @@
+#include "pathfinding.hpp"
+#include <algorithm>
+
+const int CHUNK_AREA = CHUNK_TILES*CHUNK_TILES; 
+const uint16_t NO_PARENT = 0xFFFF; 
+
+//How a visited node was reached.
+enum PathLink {
+    LINK_START, //From the start tile, along start_parent.
+    LINK_GRAPH, //Along a chunk graph edge.
+    LINK_GOAL, //To the goal tile, along goal_parent.
+}; 
+
+static inline uint64_t pack_tile(int row, int col) {
+    return ((uint64_t) (uint32_t) row << 32) | (uint32_t) col; 
+}
+
+static inline PathTile unpack_tile(uint64_t key) {
+    return PathTile {(int) (int32_t) (key >> 32), (int) (int32_t) (uint32_t) key}; 
+}
+
+static inline int floor_div(int a, int b) {
+    return a >= 0 ? a / b : -((-a - 1) / b) - 1; 
+}
+
+static inline ChunkIndices tile_chunk(uint64_t key) {
+    PathTile t = unpack_tile(key); 
+    return ChunkIndices {floor_div(t.row, CHUNK_TILES), floor_div(t.col, CHUNK_TILES)}; 
+}
+
+//Index of tile key inside chunk c.
+static inline int local_index(uint64_t key, ChunkIndices c) {
+    PathTile t = unpack_tile(key); 
+    return (t.row - c.row*CHUNK_TILES)*CHUNK_TILES + (t.col - c.col*CHUNK_TILES); 
+}
+
+static inline uint64_t local_key(int index, ChunkIndices c) {
+    return pack_tile(c.row*CHUNK_TILES + index / CHUNK_TILES, c.col*CHUNK_TILES + index % CHUNK_TILES); 
+}
+
+static inline int manhattan(uint64_t a, uint64_t b) {
+    PathTile ta = unpack_tile(a); PathTile tb = unpack_tile(b); 
+    return std::abs(ta.row - tb.row) + std::abs(ta.col - tb.col); 
+}
+
+static inline bool open_tile(Chunk *chunk, int index) {
+    return chunk->tiles[index].tile_id == TILE_AIR; 
+}
+
+Pathfinder::Pathfinder() {
+    queue_head = 0; 
+    next_id = 1; 
+    searching = false; 
+    start_dist.resize(CHUNK_AREA); goal_dist.resize(CHUNK_AREA); 
+    start_parent.resize(CHUNK_AREA); goal_parent.resize(CHUNK_AREA); 
+    expansions = 0; 
+    rebuilds = 0; 
+}
+
+//4-connected BFS over open tiles of chunk from local tile src. Unreached tiles get -1.
+//parent[i] is the neighbour one step closer to src.
+static void chunk_bfs(Chunk *chunk, int src, int *dist, uint16_t *parent, int *queue) {
+    std::fill(dist, dist + CHUNK_AREA, -1); 
+    std::fill(parent, parent + CHUNK_AREA, NO_PARENT); 
+    if(!open_tile(chunk, src)) return; 
+    int head = 0; int tail = 0; 
+    queue[tail++] = src; 
+    dist[src] = 0; 
+    while (head < tail) {
+        int i = queue[head++]; 
+        int r = i / CHUNK_TILES; int c = i % CHUNK_TILES; 
+        int next[4] = {r > 0 ? i - CHUNK_TILES : -1, r < CHUNK_TILES-1 ? i + CHUNK_TILES : -1,
+                        c > 0 ? i - 1 : -1, c < CHUNK_TILES-1 ? i + 1 : -1}; 
+        for (int k = 0; k < 4; k++) {
+            int n = next[k]; 
+            if(n >= 0 && dist[n] < 0 && open_tile(chunk, n)) {
+                dist[n] = dist[i] + 1; 
+                parent[n] = i; 
+                queue[tail++] = n; 
+            }
+        }
+    }
+}
+
+//Chunks above, below, left and right of c, the order of ChunkGraph::missing bits.
+static void neighbours(ChunkIndices c, ChunkIndices *out) {
+    out[0] = {c.row - 1, c.col}; out[1] = {c.row + 1, c.col}; 
+    out[2] = {c.row, c.col - 1}; out[3] = {c.row, c.col + 1}; 
+}
+
+//Positions along the border between lo and the chunk after it (below if vertical is false,
+//right if true) that get a transition. Both chunks see the same list.
+static void border_transitions(Chunk *lo, Chunk *hi, bool vertical, std::vector<int> *out) {
+    out->clear(); 
+    int run = -1; 
+    for (int i = 0; i <= CHUNK_TILES; i++) {
+        bool open = false; 
+        if(i < CHUNK_TILES) {
+            int a = vertical ? i*CHUNK_TILES + CHUNK_TILES-1 : (CHUNK_TILES-1)*CHUNK_TILES + i; 
+            int b = vertical ? i*CHUNK_TILES : i; 
+            open = open_tile(lo, a) && open_tile(hi, b); 
+        }
+        if(open && run < 0) {
+            run = i; 
+        } else if(!open && run >= 0) {
+            int end = i - 1; 
+            if(end - run + 1 > PATH_ENTRANCE_SPLIT) {
+                out->push_back(run); out->push_back(end); 
+            } else {
+                out->push_back((run + end) / 2); 
+            }
+            run = -1; 
+        }
+    }
+}
+
+struct GraphLink {
+    int from; //Local tile.
+    uint64_t to; 
+    int cost; 
+    int path; 
+}; 
+
+int ensure_chunk_graph(Pathfinder *pf, World *w, ChunkIndices c) {
+    ChunkGraph *g = &pf->graphs[c]; 
+    if(g->valid) return 0; 
+    g->nodes.clear(); g->edges.clear(); g->edge_start.clear(); 
+    g->path_start.clear(); g->path_tiles.clear(); 
+    g->missing = 0; 
+    Chunk *chunk = query_chunk(w, c); 
+    if(chunk == nullptr) {
+        return 1; //Stays invalid, retried once loaded.
+    }
+    pf->rebuilds += 1; 
+
+    //Entrance tiles on each border, and the step across to the neighbour.
+    std::vector<GraphLink> links; 
+    std::vector<int> transitions; 
+    ChunkIndices nc[4]; 
+    neighbours(c, nc); 
+    for (int d = 0; d < 4; d++) {
+        Chunk *n = query_chunk(w, nc[d]); 
+        if(n == nullptr) {
+            g->missing |= 1 << d; 
+            continue; 
+        }
+        bool vertical = d >= 2; 
+        bool before = d == 0 || d == 2; //Neighbour is lo side of the border.
+        border_transitions(before ? n : chunk, before ? chunk : n, vertical, &transitions); 
+        for (int k = 0; k < transitions.size(); k++) {
+            int i = transitions[k]; 
+            int edge = before ? 0 : CHUNK_TILES-1; 
+            int across = before ? CHUNK_TILES-1 : 0; 
+            int inside = vertical ? i*CHUNK_TILES + edge : edge*CHUNK_TILES + i; 
+            int outside = vertical ? i*CHUNK_TILES + across : across*CHUNK_TILES + i; 
+            links.push_back(GraphLink {inside, local_key(outside, nc[d]), 1, -1}); 
+        }
+    }
+    for (int k = 0; k < links.size(); k++) {
+        g->nodes.push_back(local_key(links[k].from, c)); 
+    }
+    std::sort(g->nodes.begin(), g->nodes.end()); 
+    g->nodes.erase(std::unique(g->nodes.begin(), g->nodes.end()), g->nodes.end()); 
+
+    //BFS from each node gives every other node's path to it.
+    std::vector<int> dist(CHUNK_AREA), queue(CHUNK_AREA); 
+    std::vector<uint16_t> parent(CHUNK_AREA); 
+    g->path_start.push_back(0); 
+    for (int i = 0; i < g->nodes.size(); i++) {
+        int dst = local_index(g->nodes[i], c); 
+        chunk_bfs(chunk, dst, dist.data(), parent.data(), queue.data()); 
+        for (int j = 0; j < g->nodes.size(); j++) {
+            int src = local_index(g->nodes[j], c); 
+            if(j == i || dist[src] < 0) continue; 
+            for (int t = parent[src]; t != NO_PARENT; t = parent[t]) {
+                g->path_tiles.push_back(t); 
+            }
+            links.push_back(GraphLink {src, g->nodes[i], dist[src], (int) g->path_start.size() - 1}); 
+            g->path_start.push_back(g->path_tiles.size()); 
+        }
+    }
+
+    std::sort(links.begin(), links.end(), [](const GraphLink &a, const GraphLink &b) {
+        if(a.from != b.from) return a.from < b.from; 
+        return a.to < b.to; 
+    }); 
+    //Nodes are sorted by key, which within a chunk is the same order as local index.
+    g->edge_start.assign(g->nodes.size() + 1, 0); 
+    for (int k = 0; k < links.size(); k++) {
+        int n = std::lower_bound(g->nodes.begin(), g->nodes.end(), local_key(links[k].from, c)) - g->nodes.begin(); 
+        g->edge_start[n + 1] += 1; 
+        g->edges.push_back(PathEdge {links[k].to, links[k].cost, links[k].path}); 
+    }
+    for (int n = 0; n < g->nodes.size(); n++) {
+        g->edge_start[n + 1] += g->edge_start[n]; 
+    }
+    if(g->missing) {
+        pf->partial.push_back(c); 
+    }
+    g->valid = true; 
+    return g->nodes.size() + 1; 
+}
+
+int request_path(Pathfinder *pf, PathTile start, PathTile goal) {
+    int id = pf->next_id++; 
+    pf->queue.push_back(PathRequest {id, start, goal}); 
+    return id; 
+}
+
+static void invalidate_graph(Pathfinder *pf, ChunkIndices c) {
+    auto it = pf->graphs.find(c); 
+    if(it != pf->graphs.end()) {
+        it->second.valid = false; 
+    }
+}
+
+void invalidate_path_graphs(Pathfinder *pf, std::vector<ChunkIndices> *touched) {
+    for (int i = 0; i < touched->size(); i++) {
+        ChunkIndices c = (*touched)[i]; 
+        //Border entrances depend on both sides, so neighbours' node sets change too.
+        ChunkIndices nc[4]; 
+        neighbours(c, nc); 
+        invalidate_graph(pf, c); 
+        for (int d = 0; d < 4; d++) {
+            invalidate_graph(pf, nc[d]); 
+        }
+    }
+    if(touched->size() > 0 && pf->searching) {
+        pf->searching = false; 
+        pf->queue_head -= 1; //Run the same request again.
+    }
+}
+
+//Graphs of chunks that are no longer resident are dropped, and rebuild if a search reaches
+//them again. Partial graphs whose neighbours have since loaded are marked for rebuild.
+static void recheck_partial(Pathfinder *pf, World *w) {
+    for (auto it = pf->graphs.begin(); it != pf->graphs.end();) {
+        if(query_chunk(w, it->first) == nullptr) {
+            it = pf->graphs.erase(it); 
+        } else {
+            it++; 
+        }
+    }
+    int count = 0; 
+    for (int i = 0; i < pf->partial.size(); i++) {
+        ChunkIndices c = pf->partial[i]; 
+        auto it = pf->graphs.find(c); 
+        if(it == pf->graphs.end()) {
+            continue; //Dropped above.
+        }
+        ChunkGraph *g = &it->second; 
+        if(!g->valid || !g->missing) {
+            continue; //Already rebuilt, and listed again if still partial.
+        }
+        ChunkIndices nc[4]; 
+        neighbours(c, nc); 
+        bool loaded = false; 
+        for (int d = 0; d < 4; d++) {
+            if((g->missing & (1 << d)) && query_chunk(w, nc[d]) != nullptr) {
+                invalidate_graph(pf, nc[d]); 
+                loaded = true; 
+            }
+        }
+        if(loaded) {
+            g->valid = false; 
+        } else {
+            pf->partial[count++] = c; 
+        }
+    }
+    pf->partial.resize(count); 
+}
+
+static void relax(Pathfinder *pf, uint64_t from, uint64_t to, int g, int link) {
+    auto it = pf->visits.find(to); 
+    if(it != pf->visits.end() && (it->second.closed || it->second.g <= g)) {
+        return; 
+    }
+    pf->visits[to] = PathVisit {g, from, link, false}; 
+    pf->open.push_back(PathOpen {g + manhattan(to, pf->goal_key), to}); 
+    std::push_heap(pf->open.begin(), pf->open.end(), [](const PathOpen &a, const PathOpen &b) {
+        return a.f > b.f || (a.f == b.f && a.key > b.key); 
+    }); 
+}
+
+static PathOpen pop_open(Pathfinder *pf) {
+    std::pop_heap(pf->open.begin(), pf->open.end(), [](const PathOpen &a, const PathOpen &b) {
+        return a.f > b.f || (a.f == b.f && a.key > b.key); 
+    }); 
+    PathOpen o = pf->open.back(); 
+    pf->open.pop_back(); 
+    return o; 
+}
+
+static void finish(Pathfinder *pf, PathStatus status) {
+    pf->results.push_back(PathResult {pf->active.id, status}); 
+    pf->searching = false; 
+}
+
+//Starts the search for pf->active. Returns work done.
+static int begin_search(Pathfinder *pf, World *w) {
+    PathRequest r = pf->active; 
+    pf->start_key = pack_tile(r.start.row, r.start.col); 
+    pf->goal_key = pack_tile(r.goal.row, r.goal.col); 
+    pf->start_chunk = tile_chunk(pf->start_key); 
+    pf->goal_chunk = tile_chunk(pf->goal_key); 
+    pf->open.clear(); 
+    pf->visits.clear(); 
+    pf->searching = true; 
+    Chunk *sc = query_chunk(w, pf->start_chunk); 
+    Chunk *gc = query_chunk(w, pf->goal_chunk); 
+    if(sc == nullptr || gc == nullptr) {
+        finish(pf, PATH_NONE); 
+        return 1; 
+    }
+    std::vector<int> queue(CHUNK_AREA); 
+    chunk_bfs(sc, local_index(pf->start_key, pf->start_chunk), pf->start_dist.data(), pf->start_parent.data(), queue.data()); 
+    chunk_bfs(gc, local_index(pf->goal_key, pf->goal_chunk), pf->goal_dist.data(), pf->goal_parent.data(), queue.data()); 
+    if(pf->start_dist[local_index(pf->start_key, pf->start_chunk)] < 0 || pf->goal_dist[local_index(pf->goal_key, pf->goal_chunk)] < 0) {
+        finish(pf, PATH_NONE); //Start or goal is solid.
+        return 2; 
+    }
+    relax(pf, pf->start_key, pf->start_key, 0, LINK_START); 
+    return 2 + ensure_chunk_graph(pf, w, pf->start_chunk); 
+}
+
+//Appends the tiles after from, up to and including to.
+static void append_step(Pathfinder *pf, uint64_t from, uint64_t to, int link, std::vector<PathTile> *tiles) {
+    if(link == LINK_START) {
+        //start_parent leads back to the start, so walk it and reverse.
+        int first = tiles->size(); 
+        for (int t = local_index(to, pf->start_chunk); t != NO_PARENT && local_key(t, pf->start_chunk) != from; t = pf->start_parent[t]) {
+            tiles->push_back(unpack_tile(local_key(t, pf->start_chunk))); 
+        }
+        std::reverse(tiles->begin() + first, tiles->end()); 
+    } else if(link == LINK_GOAL) {
+        for (int t = pf->goal_parent[local_index(from, pf->goal_chunk)]; t != NO_PARENT; t = pf->goal_parent[t]) {
+            tiles->push_back(unpack_tile(local_key(t, pf->goal_chunk))); 
+        }
+    } else {
+        ChunkIndices c = tile_chunk(from); 
+        ChunkGraph *g = &pf->graphs[c]; 
+        int n = std::lower_bound(g->nodes.begin(), g->nodes.end(), from) - g->nodes.begin(); 
+        for (int e = g->edge_start[n]; e < g->edge_start[n + 1]; e++) {
+            PathEdge edge = g->edges[e]; 
+            if(edge.to != to) continue; 
+            if(edge.path < 0) {
+                tiles->push_back(unpack_tile(to)); 
+            } else {
+                for (int k = g->path_start[edge.path]; k < g->path_start[edge.path + 1]; k++) {
+                    tiles->push_back(unpack_tile(local_key(g->path_tiles[k], c))); 
+                }
+            }
+            return; 
+        }
+    }
+}
+
+static void build_result(Pathfinder *pf) {
+    std::vector<uint64_t> chain; 
+    for (uint64_t k = pf->goal_key; ; k = pf->visits[k].from) {
+        chain.push_back(k); 
+        if(k == pf->start_key) break; 
+    }
+    std::reverse(chain.begin(), chain.end()); 
+    finish(pf, PATH_FOUND); 
+    std::vector<PathTile> *tiles = &pf->results.back().tiles; 
+    tiles->push_back(unpack_tile(pf->start_key)); 
+    for (int i = 1; i < chain.size(); i++) {
+        append_step(pf, chain[i-1], chain[i], pf->visits[chain[i]].link, tiles); 
+    }
+}
+
+//Expands one node. Returns work done.
+static int search_step(Pathfinder *pf, World *w) {
+    if(pf->open.empty()) {
+        finish(pf, PATH_NONE); 
+        return 1; 
+    }
+    PathOpen o = pop_open(pf); 
+    PathVisit *v = &pf->visits[o.key]; 
+    if(v->closed) return 0; 
+    v->closed = true; 
+    int g = v->g; 
+    if(o.key == pf->goal_key) {
+        build_result(pf); 
+        return 1; 
+    }
+    pf->expansions += 1; 
+    int work = 1; 
+    ChunkIndices c = tile_chunk(o.key); 
+    if(o.key == pf->start_key) {
+        ChunkGraph *sg = &pf->graphs[pf->start_chunk]; 
+        for (int i = 0; i < sg->nodes.size(); i++) {
+            int d = pf->start_dist[local_index(sg->nodes[i], pf->start_chunk)]; 
+            if(d > 0) relax(pf, o.key, sg->nodes[i], g + d, LINK_START); 
+        }
+    }
+    work += ensure_chunk_graph(pf, w, c); 
+    ChunkGraph *cg = &pf->graphs[c]; 
+    auto it = std::lower_bound(cg->nodes.begin(), cg->nodes.end(), o.key); 
+    if(it != cg->nodes.end() && *it == o.key) {
+        int n = it - cg->nodes.begin(); 
+        for (int e = cg->edge_start[n]; e < cg->edge_start[n + 1]; e++) {
+            relax(pf, o.key, cg->edges[e].to, g + cg->edges[e].cost, LINK_GRAPH); 
+        }
+    }
+    if(c == pf->goal_chunk) {
+        int d = pf->goal_dist[local_index(o.key, c)]; 
+        if(d >= 0) relax(pf, o.key, pf->goal_key, g + d, LINK_GOAL); 
+    }
+    return work; 
+}
+
+void update_pathfinder(Pathfinder *pf, World *w, int budget) {
+    while (budget > 0) {
+        if(!pf->searching) {
+            if(pf->queue_head >= pf->queue.size()) {
+                pf->queue.clear(); 
+                pf->queue_head = 0; 
+                return; 
+            }
+            recheck_partial(pf, w); 
+            pf->active = pf->queue[pf->queue_head++]; 
+            budget -= begin_search(pf, w); 
+            continue; 
+        }
+        budget -= search_step(pf, w); 
+    }
+}
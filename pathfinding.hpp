@@ -0,0 +1,107 @@
+#ifndef HEADERFILE_PATHFINDING
+#define HEADERFILE_PATHFINDING
+
+#include <vector>
+#include <unordered_map>
+#include "terrain.hpp"
+
+/*
+Hierarchical pathfinding (HPA*) with chunks as clusters. Runs of open tiles along a chunk
+border become entrances, with a node on the tile each side. Nodes in one chunk are joined by
+edges whose tile paths are found by BFS when the chunk's graph is built, and cached. A query
+searches the small graph of entrances, then splices the cached paths into a tile path.
+
+Agents count as one tile and move between 4-connected air tiles. Chunk graphs build lazily as
+searches reach them, are dropped once their chunk is unloaded, and only chunks next to an edit
+rebuild. Searches share a per-tick work
+budget and resume on the next tick when it runs out.
+*/
+
+//Global tile coordinates, row = chunk_row*CHUNK_TILES + row inside the chunk.
+struct PathTile {
+	int row, col; 
+}; 
+
+struct PathEdge {
+	uint64_t to; //Tile key of the node at the other end.
+	int cost; 
+	int path; //Cached path in the chunk's graph, -1 for a step across the border.
+}; 
+
+struct ChunkGraph {
+	std::vector<uint64_t> nodes; //Sorted tile keys of entrance tiles inside the chunk.
+	std::vector<int> edge_start; //Edges of nodes[i] are edges[edge_start[i], edge_start[i+1]).
+	std::vector<PathEdge> edges; 
+	//Cached path p is path_tiles[path_start[p], path_start[p+1]), as row*CHUNK_TILES + col
+	//inside the chunk. Excludes the tile it starts from.
+	std::vector<int> path_start; 
+	std::vector<uint16_t> path_tiles; 
+	bool valid = false; 
+	uint8_t missing = 0; //Bit d set if neighbour d wasn't loaded at build, so that border has no entrances.
+}; 
+
+const int PATH_ENTRANCE_SPLIT = 6; //Entrances wider than this get a node at each end instead of the middle.
+const int PATH_TICK_BUDGET = 4096; //Work per tick across all searches.
+
+struct PathRequest {
+	int id; 
+	PathTile start, goal; 
+}; 
+
+enum PathStatus {
+	PATH_FOUND, PATH_NONE
+}; 
+
+struct PathResult {
+	int id; 
+	PathStatus status; 
+	std::vector<PathTile> tiles; //Start to goal inclusive.
+}; 
+
+struct PathVisit {
+	int g; 
+	uint64_t from; 
+	int link; //How from reaches this node, see PathLink in pathfinding.cpp.
+	bool closed; 
+}; 
+
+struct PathOpen {
+	int f; 
+	uint64_t key; 
+}; 
+
+struct Pathfinder {
+	std::unordered_map<ChunkIndices, ChunkGraph> graphs; 
+	std::vector<ChunkIndices> partial; //Chunks with partial graphs, rechecked between searches.
+	std::vector<PathRequest> queue; 
+	int queue_head; 
+	int next_id; 
+	std::vector<PathResult> results; //Finished searches. Caller reads and clears.
+
+	//Search in progress, kept across ticks so it can resume.
+	bool searching; 
+	PathRequest active; 
+	uint64_t start_key, goal_key; 
+	ChunkIndices start_chunk, goal_chunk; 
+	std::vector<int> start_dist, goal_dist; //BFS from start and goal within their chunks, -1 if unreached.
+	std::vector<uint16_t> start_parent, goal_parent; 
+	std::vector<PathOpen> open; //Min heap on f.
+	std::unordered_map<uint64_t, PathVisit> visits; 
+
+	int expansions; //Totals, for tuning the budget.
+	int rebuilds; 
+	Pathfinder(); 
+}; 
+
+//Queues a search from start to goal. Its result appears in pf->results under the returned id.
+int request_path(Pathfinder *pf, PathTile start, PathTile goal); 
+//Runs queued searches until budget units of work are spent. A node expansion is one unit,
+//building a chunk graph is one per BFS.
+void update_pathfinder(Pathfinder *pf, World *w, int budget); 
+//Rebuilds graphs around chunks changed by apply_tile_edits or rollback_tile_edits. Pass journal.touched.
+//Restarts the search in progress.
+void invalidate_path_graphs(Pathfinder *pf, std::vector<ChunkIndices> *touched); 
+//Builds the graph for c if it's missing or stale. Returns work done.
+int ensure_chunk_graph(Pathfinder *pf, World *w, ChunkIndices c); 
+
+#endif
@@ -39,6 +39,68 @@ bool polygon_rectangle_update(PhysicsPolygon* poly, glm::dvec2 p0, glm::dvec2 p1
     return has_collision; 
 }
 
+//Interval of the shape's vertices projected onto axis. 
+static void project(const glm::dvec2 *v, int n, glm::dvec2 axis, double *lo, double *hi) {
+    *lo = INFINITY; *hi = -INFINITY; 
+    for (int i = 0; i < n; i++) {
+        double d = glm::dot(v[i], axis); 
+        *lo = std::min(*lo, d); *hi = std::max(*hi, d); 
+    }
+}
+
+//True if an edge normal of s separates s from o by more than margin. Shapes with fewer than 3 
+//vertices also try their edge direction, and the axis between first vertices, so points and 
+//collinear segments are handled. 
+static bool separated_by(const glm::dvec2 *s, int ns, const glm::dvec2 *o, int no, double margin) {
+    int edges = ns >= 3 ? ns : 1; 
+    for (int i = 0; i < edges; i++) {
+        glm::dvec2 side = s[(i+1) % ns] - s[i]; 
+        glm::dvec2 axes[3] = {glm::dvec2(side.y, -side.x), side, o[0] - s[0]}; 
+        int num_axes = ns >= 3 ? 1 : 3; 
+        for (int k = 0; k < num_axes; k++) {
+            double len = glm::length(axes[k]); 
+            if(len == 0) continue; 
+            glm::dvec2 axis = axes[k] / len; 
+            double slo, shi, olo, ohi; 
+            project(s, ns, axis, &slo, &shi); 
+            project(o, no, axis, &olo, &ohi); 
+            if(olo - shi > margin || slo - ohi > margin) return true; 
+        }
+    }
+    return false; 
+}
+
+static double point_segment_distance(glm::dvec2 p, glm::dvec2 s0, glm::dvec2 s1) {
+    glm::dvec2 side = s1 - s0; 
+    double len2 = glm::dot(side, side); 
+    double t = len2 > 0 ? glm::clamp(glm::dot(p - s0, side) / len2, 0.0, 1.0) : 0.0; 
+    return glm::length(p - (s0 + side * t)); 
+}
+
+//Smallest distance from a vertex of s to an edge of o. 
+static double vertex_edge_distance(const glm::dvec2 *s, int ns, const glm::dvec2 *o, int no) {
+    double d = INFINITY; 
+    int edges = no >= 3 ? no : 1; 
+    for (int j = 0; j < edges; j++) {
+        glm::dvec2 s0 = o[j]; glm::dvec2 s1 = o[(j+1) % no]; 
+        for (int i = 0; i < ns; i++) {
+            d = std::min(d, point_segment_distance(s[i], s0, s1)); 
+        }
+    }
+    return d; 
+}
+
+bool convex_overlap(const glm::dvec2 *a, int na, double ra, const glm::dvec2 *b, int nb, double rb) {
+    double r = ra + rb; 
+    //Inflated test first. Rejects most pairs, and is exact for plain polygons. 
+    if(separated_by(a, na, b, nb, r) || separated_by(b, nb, a, na, r)) return false; 
+    if(r == 0) return true; 
+    //Cores touch, or are closer than r at a vertex to edge pair. 
+    if(!separated_by(a, na, b, nb, 0) && !separated_by(b, nb, a, na, 0)) return true; 
+    double d = std::min(vertex_edge_distance(a, na, b, nb), vertex_edge_distance(b, nb, a, na)); 
+    return d <= r; 
+}
+
 glm::dvec2 getConstrainedSurfaceVel(glm::dvec2 v, glm::dvec2 norm) {
 	double norm_vel = std::min(glm::dot(v, norm), 0.0); 
 	v -= norm*norm_vel; 
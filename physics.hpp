@@ -60,6 +60,9 @@ struct Rect {
 }; 
 
 bool point_segment_update(glm::dvec2 p0, glm::dvec2 p1, glm::dvec2 s0, glm::dvec2 s1, Collision *c); 
+//Overlap of two convex shapes, each inflated by a radius. 1 vertex is a circle, 2 a capsule, 3+ a polygon. 
+//Separating axis test over both shapes' edges, with an exact distance check when radii are nonzero. 
+bool convex_overlap(const glm::dvec2 *a, int na, double ra, const glm::dvec2 *b, int nb, double rb); 
 bool polygon_rectangle_update(PhysicsPolygon* poly, glm::dvec2 p0, glm::dvec2 p1, Rect r, Collision *c); 
 
 glm::dvec2 getConstrainedSurfaceVel(glm::dvec2 v, glm::dvec2 norm); 
@@ -1,16 +1,21 @@
 #include "renderer.hpp"
 #include <stdio.h>
+#include <string.h>
+#ifdef SPRITE_JSON
 #include <json.hpp>
 #include <iostream>     // std::cout
 #include <fstream>      // std::ifstream
-
 using json = nlohmann::json;
+#endif
+#include <algorithm>
 
 //The window we'll be rendering to
 SDL_Window* gWindow = NULL;
 //The window renderer
 SDL_Renderer* gRenderer = NULL;
 
+SDL_Surface* gFramebuffer = NULL; 
+
 SDL_Texture* loadTextureFromFile(char *path) {
 	//The final texture
 	SDL_Texture* newTexture = NULL;
@@ -35,47 +40,80 @@ SDL_Texture* loadTextureFromFile(char *path) {
 	return newTexture; 
 }
 
-SpriteSheet::SpriteSheet(char *path) {
+SpriteSheet::SpriteSheet() {
+	texture = NULL; 
+	manifest.data = NULL; 
+	manifest.mapped = false; 
+	sprites.push_back(Sprite {1, SDL_Rect {0, 0, 0, 0}, NULL}); //SPRITE_NONE 
+}
+
+//Loads the textures of every page in sheet's manifest, and its tile table. 
+static bool loadPages(SpriteSheet *sheet) {
+	const AtlasManifest *m = &sheet->manifest; 
+	for (int i = 0; i < m->header->page_count; i++) {
+		SDL_Texture *t = loadTextureFromFile((char*) manifest_string(m, m->pages[i].path)); 
+		if(t == NULL) return false; 
+		sheet->textures.push_back(t); 
+	}
+	sheet->texture = sheet->textures.empty() ? NULL : sheet->textures[0]; 
+	for (int i = 0; i < m->header->sprite_count; i++) {
+		const AtlasSprite *a = &m->sprites[i]; 
+		sheet->sprites.push_back(Sprite {a->frames, SDL_Rect {a->x, a->y, a->w / a->frames, a->h}, sheet->textures[a->page]}); 
+	}
+	for (int i = 0; i < m->header->tile_count; i++) {
+		const AtlasTile *a = &m->tiles[i]; 
+		sheet->tiles.push_back(Sprite {1, SDL_Rect {a->x, a->y, a->w, a->h}, sheet->textures[a->page]}); 
+	}
+	return true; 
+}
+
+#ifdef SPRITE_JSON
+SpriteSheet::SpriteSheet(char *path) : SpriteSheet() {
 	std::ifstream ifs(path);
 	json j = json::parse(ifs); 
-	// std::cout << j; 
-	// std::cout << j["texture_path"] << "\n"; 
-	std::string str = j["texture_path"].get<std::string>(); 
-	char *texture_path = (char *) calloc(str.size(), sizeof(char)); 
-	// printf("str size %d\n", str.size()); 
-	for (int i = 0; i < str.size(); i++) {
-		texture_path[i] = str[i]; 
+	std::vector<std::string> pages = {j["texture_path"].get<std::string>()}; 
+	std::vector<ManifestSprite> sprites; 
+	std::vector<AtlasTile> no_tiles; 
+	for (auto& entry : j["sprite_entries"].items()) {
+		json location = entry.value()["location"]; 
+		ManifestSprite s = {entry.key(), 0, (uint16_t) entry.value()["frames"].get<int>(), 
+							location[0].get<int>(), location[1].get<int>(), location[2].get<int>(), location[3].get<int>()}; 
+		sprites.push_back(s); 
 	}
-	
-	// printf("loading from %s\n", texture_path); 
-	texture = loadTextureFromFile(texture_path); 
-	free(texture_path); 
-	json sprite_j = j["sprite_entries"]; 
-	// iterate the array
-	for (auto& entry : sprite_j.items()) {
-		std::string s = entry.key(); 
-		json info = entry.value(); 
-		int frames = info["frames"].get<int>(); 
-		json location = info["location"]; 
-		int ls[4];
-		int i = 0; 
-		for (auto& l : location) {
-			ls[i] = l.get<int>(); 
-			// printf("%d ", ls[i]); 
-			i += 1; 
-			// printf("\n"); 
-		}
-		SDL_Rect *r = (SDL_Rect*) &ls; 
-		Sprite spr = {frames, *r, texture}; 
-		spr.r.w /= spr.frames; 
-		// std::cout << s << " " << frames << "\n"; 
-		// printf("%d, %d, %d, %d\n", spr.r.x, spr.r.y, spr.r.w, spr.r.h); 
-		entry_map[s] = spr; 
+	write_manifest(&manifest_bytes, &pages, sprites, &no_tiles); 
+	if(view_manifest(&manifest, manifest_bytes.data(), manifest_bytes.size())) {
+		loadPages(this); 
+	}
+}
+#endif
+
+SpriteHandle SpriteSheet::getSpriteHandle(const char *name) {
+	const AtlasSprite *a = manifest.data == NULL ? NULL : find_manifest_sprite(&manifest, name); 
+	SpriteHandle h = a == NULL ? SPRITE_NONE : (a - manifest.sprites) + 1; 
+	if(h == SPRITE_NONE || h >= sprites.size()) {
+		printf("No sprite named %s\n", name); 
+		return SPRITE_NONE; 
 	}
-} 
+	return h; 
+}
 
-Sprite SpriteSheet::getSpriteEntry(std::string sprite_name) {
-	return entry_map.at(sprite_name);
+void SpriteSheet::addTileStrip(SDL_Texture *strip, int tile_pixels) {
+	int w, h; 
+	SDL_QueryTexture(strip, NULL, NULL, &w, &h); 
+	for (int x = 0; x + tile_pixels <= w; x += tile_pixels) {
+		tiles.push_back(Sprite {1, SDL_Rect {x, 0, tile_pixels, tile_pixels}, strip}); 
+	}
+}
+
+SpriteSheet* loadSpriteSheet(char *path) {
+	SpriteSheet *sheet = new SpriteSheet(); 
+	if(!map_manifest(&sheet->manifest, path) || !loadPages(sheet)) {
+		for (int i = 0; i < sheet->textures.size(); i++) SDL_DestroyTexture(sheet->textures[i]); 
+		close_manifest(&sheet->manifest); 
+		delete sheet; 
+		return NULL; 
+	}
+	return sheet; 
 }
 
 void renderSprite(Sprite s, SDL_Rect *r, int frame) {
@@ -94,6 +132,94 @@ void renderHealthbar(int health, int max_health, SDL_Rect bar_dest) {
 	SDL_RenderDrawRect(gRenderer, &bar_dest);
 }
 
+SpriteBatch::SpriteBatch() {
+	draw_calls = 0; 
+}
+
+//Slot of texture among those batched this frame. Few textures are in use, so a scan is enough. 
+static int textureSlot(SpriteBatch *b, SDL_Texture *texture) {
+	for (int i = 0; i < b->textures.size(); i++) {
+		if(b->textures[i] == texture) return i; 
+	}
+	int w = 1, h = 1; 
+	if(texture != NULL) {
+		SDL_QueryTexture(texture, NULL, NULL, &w, &h); 
+	}
+	b->textures.push_back(texture); 
+	b->texture_dims.push_back(SDL_FPoint {(float) w, (float) h}); 
+	return b->textures.size() - 1; 
+}
+
+void batchQuad(SpriteBatch *b, int layer, SDL_Texture *texture, SDL_Rect *src, SDL_Rect *dest, SDL_Color color) {
+	uint64_t slot = textureSlot(b, texture); 
+	b->keys.push_back(((uint64_t) layer << 48) | (slot << 32) | b->quads.size()); 
+	BatchQuad q = {SDL_FRect {(float) dest->x, (float) dest->y, (float) dest->w, (float) dest->h}, 
+					src == NULL ? SDL_Rect {0, 0, 0, 0} : *src, color}; 
+	b->quads.push_back(q); 
+}
+
+void batchSprite(SpriteBatch *b, int layer, Sprite s, SDL_Rect *r, int frame) {
+	SDL_Rect src = s.r; 
+	src.x += s.r.w * frame; 
+	batchQuad(b, layer, s.texture, &src, r, SDL_Color {255, 255, 255, 255}); 
+}
+
+void batchFillRect(SpriteBatch *b, int layer, SDL_Rect *r, SDL_Color color) {
+	batchQuad(b, layer, NULL, NULL, r, color); 
+}
+
+void batchDrawRect(SpriteBatch *b, int layer, SDL_Rect *r, SDL_Color color) {
+	SDL_Rect edges[4] = {{r->x, r->y, r->w, 1}, {r->x, r->y + r->h - 1, r->w, 1}, 
+						{r->x, r->y + 1, 1, r->h - 2}, {r->x + r->w - 1, r->y + 1, 1, r->h - 2}}; 
+	for (int i = 0; i < 4; i++) {
+		if(edges[i].w > 0 && edges[i].h > 0) batchFillRect(b, layer, &edges[i], color); 
+	}
+}
+
+void batchHealthbar(SpriteBatch *b, int layer, int health, int max_health, SDL_Rect bar_dest) {
+	int w = bar_dest.w; 
+	bar_dest.w = w*health / max_health; 
+	batchFillRect(b, layer, &bar_dest, SDL_Color {128, 0, 0, 255}); 
+	bar_dest.w = w; 
+	batchDrawRect(b, layer, &bar_dest, SDL_Color {128, 128, 128, 255}); 
+}
+
+void flushSpriteBatch(SpriteBatch *b) {
+	std::sort(b->keys.begin(), b->keys.end()); 
+	b->draw_calls = 0; 
+	int start = 0; 
+	while (start < b->keys.size()) {
+		//Run of quads sharing layer and texture. 
+		uint64_t run = b->keys[start] >> 32; 
+		int end = start; 
+		b->vertices.clear(); 
+		b->indices.clear(); 
+		int slot = run & 0xFFFF; 
+		SDL_FPoint dim = b->texture_dims[slot]; 
+		while (end < b->keys.size() && (b->keys[end] >> 32) == run) {
+			BatchQuad *q = &b->quads[b->keys[end] & 0xFFFFFFFF]; 
+			float u0 = q->src.x / dim.x; float v0 = q->src.y / dim.y; 
+			float u1 = (q->src.x + q->src.w) / dim.x; float v1 = (q->src.y + q->src.h) / dim.y; 
+			int v = b->vertices.size(); 
+			b->vertices.push_back(SDL_Vertex {{q->dest.x, q->dest.y}, q->color, {u0, v0}}); 
+			b->vertices.push_back(SDL_Vertex {{q->dest.x + q->dest.w, q->dest.y}, q->color, {u1, v0}}); 
+			b->vertices.push_back(SDL_Vertex {{q->dest.x + q->dest.w, q->dest.y + q->dest.h}, q->color, {u1, v1}}); 
+			b->vertices.push_back(SDL_Vertex {{q->dest.x, q->dest.y + q->dest.h}, q->color, {u0, v1}}); 
+			int quad_indices[6] = {v, v + 1, v + 2, v, v + 2, v + 3}; 
+			b->indices.insert(b->indices.end(), quad_indices, quad_indices + 6); 
+			end++; 
+		}
+		SDL_RenderGeometry(gRenderer, b->textures[slot], b->vertices.data(), b->vertices.size(), 
+							b->indices.data(), b->indices.size()); 
+		b->draw_calls += 1; 
+		start = end; 
+	}
+	b->quads.clear(); 
+	b->keys.clear(); 
+	b->textures.clear(); 
+	b->texture_dims.clear(); 
+}
+
 bool init() {
 	//Initialize SDL
 	if( SDL_Init( SDL_INIT_VIDEO ) < 0 ) {
@@ -137,13 +263,61 @@ bool init() {
 	return true;
 }
 
+bool init_headless() {
+	SDL_SetHint( SDL_HINT_VIDEODRIVER, "dummy" ); 
+	if( SDL_Init( SDL_INIT_VIDEO ) < 0 ) {
+		printf( "SDL could not initialize! %s\n", SDL_GetError() ); 
+		return false; 
+	}
+
+	//Create framebuffer and a software renderer for it
+	gFramebuffer = SDL_CreateRGBSurfaceWithFormat( 0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32 ); 
+	if( gFramebuffer == NULL ) {
+		printf( "Framebuffer could not be created! SDL Error: %s\n", SDL_GetError() ); 
+		return false; 
+	}
+	gRenderer = SDL_CreateSoftwareRenderer( gFramebuffer ); 
+	if( gRenderer == NULL ) {
+		printf( "Software renderer could not be created! SDL Error: %s\n", SDL_GetError() ); 
+		return false; 
+	}
+	SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF ); 
+
+	//Initialize PNG loading
+	int imgFlags = IMG_INIT_PNG; 
+	if( !( IMG_Init( imgFlags ) & imgFlags ) ) {
+		printf( "SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError() ); 
+		return false; 
+	}
+	return true; 
+}
+
+uint64_t hash_frame() {
+	int w, h; 
+	SDL_GetRendererOutputSize(gRenderer, &w, &h); 
+	std::vector<Uint32> pixels(w*h); 
+	if(SDL_RenderReadPixels(gRenderer, NULL, SDL_PIXELFORMAT_RGBA32, pixels.data(), w*sizeof(Uint32)) != 0) {
+		printf("Unable to read back frame! SDL Error: %s\n", SDL_GetError()); 
+		return 0; 
+	}
+	//64 bit FNV-1a over the bytes. 
+	uint64_t hash = 14695981039346656037ULL; 
+	const uint8_t *bytes = (const uint8_t*) pixels.data(); 
+	for (size_t i = 0; i < pixels.size()*sizeof(Uint32); i++) {
+		hash = (hash ^ bytes[i]) * 1099511628211ULL; 
+	}
+	return hash; 
+}
+
 void close_SDL()
 {
 	//Destroy window	
 	SDL_DestroyRenderer( gRenderer );
-	SDL_DestroyWindow( gWindow );
+	if( gWindow != NULL ) SDL_DestroyWindow( gWindow ); 
+	if( gFramebuffer != NULL ) SDL_FreeSurface( gFramebuffer ); 
 	gWindow = NULL;
 	gRenderer = NULL;
+	gFramebuffer = NULL; 
 
 	//Quit SDL subsystems
 	TTF_Quit();
@@ -5,6 +5,9 @@
 #include <SDL_image.h>
 #include <SDL_ttf.h>
 #include <map>
+#include <string>
+#include <vector>
+#include "atlas.hpp"
 
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
@@ -14,9 +17,14 @@ const int SCREEN_HEIGHT = 480;
 extern SDL_Window* gWindow;
 //The window renderer
 extern SDL_Renderer* gRenderer;
+//Memory the headless renderer draws into, NULL when drawing to the window. 
+extern SDL_Surface* gFramebuffer; 
 
 //Starts up SDL and creates window
 bool init(); 
+//Starts up SDL under the dummy video driver, with a software renderer drawing into gFramebuffer 
+//instead of a window. For benchmarks and image checks on machines without a display or GPU. 
+bool init_headless(); 
 
 //Loads media
 bool loadMedia();
@@ -26,21 +34,79 @@ void close_SDL();
 
 SDL_Texture* loadTextureFromFile(char* path);
 
+//Hash of the pixels rendered so far this frame, read back from the renderer. Equal frames hash equal. 
+uint64_t hash_frame(); 
+
 struct Sprite {
 	int frames; 
 	SDL_Rect r; //Location in texture. 
 	SDL_Texture* texture; 
 }; 
 
+//Dense index of a sprite in a SpriteSheet, resolved from its name once at load. 
+typedef uint16_t SpriteHandle; 
+const SpriteHandle SPRITE_NONE = 0; 
+
+/*
+Sprites and tiles come from a binary manifest (see atlas.hpp), mapped and used in place. Builds
+with SPRITE_JSON can also load a sprite_entries JSON file, which is compiled to the same format
+in memory. 
+*/
 struct SpriteSheet {
-	std::map<std::string, Sprite> entry_map; 
-	SDL_Texture* texture; 
-	SpriteSheet(char *path); 
-	Sprite getSpriteEntry(std::string entry_name); 
+	AtlasManifest manifest; 
+	std::vector<char> manifest_bytes; //Backing for a manifest compiled from JSON, empty if mapped. 
+	SDL_Texture* texture; //First page. 
+	std::vector<SDL_Texture*> textures; //Texture of each manifest page. 
+	std::vector<Sprite> tiles; //Source of tile id t is tiles[t-1]. 
+	std::vector<Sprite> sprites; //Indexed by handle. Manifest sprite i has handle i+1, SPRITE_NONE is empty. 
+	SpriteSheet(); 
+#ifdef SPRITE_JSON
+	SpriteSheet(char *path); //From a sprite_entries JSON file. 
+#endif
+	SpriteHandle getSpriteHandle(const char *name); //SPRITE_NONE, with a message, if there's no such sprite. 
+	const Sprite* getSprite(SpriteHandle h) { return &sprites[h]; }
+	void addTileStrip(SDL_Texture *strip, int tile_pixels); //Tiles side by side in one row, first id first. 
 };
 
+//Loads a manifest written by tools/compile_manifest or tools/pack_atlas. Returns NULL if it's 
+//missing or invalid. 
+SpriteSheet* loadSpriteSheet(char *path); 
+
 void renderSprite(Sprite s, SDL_Rect *r, int frame); 
 void renderHealthbar(int health, int max_health, SDL_Rect bar_dest); 
+
+/*
+Collects quads over a frame and draws them with one SDL_RenderGeometry call per run of
+(layer, texture). Each quad's sort key is layer, then texture, then submission order, so
+layers draw in order and quads sharing a layer and texture keep the order they were added in.
+Untextured quads (fills and outlines) use a null texture.
+*/
+enum RenderLayer {LAYER_ENTITIES, LAYER_HEALTHBARS, LAYER_HUD, LAYER_HITBOXES, LAYER_PARTICLES}; 
+
+struct BatchQuad {
+	SDL_FRect dest; 
+	SDL_Rect src; 
+	SDL_Color color; 
+}; 
+
+struct SpriteBatch {
+	std::vector<BatchQuad> quads; 
+	std::vector<uint64_t> keys; //layer << 48 | texture slot << 32 | quad index. 
+	std::vector<SDL_Texture*> textures; //Texture of each slot, for this frame. 
+	std::vector<SDL_FPoint> texture_dims; 
+	std::vector<SDL_Vertex> vertices; 
+	std::vector<int> indices; 
+	int draw_calls; //Geometry calls made by the last flush. 
+	SpriteBatch(); 
+}; 
+
+void batchQuad(SpriteBatch *b, int layer, SDL_Texture *texture, SDL_Rect *src, SDL_Rect *dest, SDL_Color color); 
+void batchSprite(SpriteBatch *b, int layer, Sprite s, SDL_Rect *r, int frame); 
+void batchFillRect(SpriteBatch *b, int layer, SDL_Rect *r, SDL_Color color); 
+void batchDrawRect(SpriteBatch *b, int layer, SDL_Rect *r, SDL_Color color); //1 pixel outline, as SDL_RenderDrawRect. 
+void batchHealthbar(SpriteBatch *b, int layer, int health, int max_health, SDL_Rect bar_dest); 
+//Draws and clears everything batched since the last flush. 
+void flushSpriteBatch(SpriteBatch *b); 
 SDL_Texture* loadTextureFromFile(char *path); 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "replay.hpp"
+#include <stdio.h>
+#include <string.h>
+
+void record_input(Replay *r, const InputState *s) {
+	ReplayInput in = {}; 
+	in.x = s->x; 
+	in.y = s->y; 
+	in.buttons = (s->mouse_down ? REPLAY_MOUSE : 0) | (s->right_mouse_down ? REPLAY_RIGHT_MOUSE : 0) | (s->j ? REPLAY_J : 0); 
+	in.mouse_x = s->mouse_pos.x; 
+	in.mouse_y = s->mouse_pos.y; 
+	r->inputs.push_back(in); 
+}
+
+InputState replay_input(const Replay *r, int tick) {
+	InputState s = {0}; 
+	if(tick < 0 || tick >= r->inputs.size()) {
+		return s; 
+	}
+	ReplayInput in = r->inputs[tick]; 
+	s.x = in.x; 
+	s.y = in.y; 
+	s.mouse_down = in.buttons & REPLAY_MOUSE; 
+	s.right_mouse_down = in.buttons & REPLAY_RIGHT_MOUSE; 
+	s.j = in.buttons & REPLAY_J; 
+	s.mouse_pos.x = in.mouse_x; 
+	s.mouse_pos.y = in.mouse_y; 
+	return s; 
+}
+
+bool save_replay(const Replay *r, const char *path) {
+	FILE *f = fopen(path, "wb"); 
+	if(f == NULL) {
+		printf("Unable to open %s for writing\n", path); 
+		return false; 
+	}
+	ReplayHeader header; 
+	memcpy(header.magic, REPLAY_MAGIC, 4); 
+	header.version = REPLAY_VERSION; 
+	header.tick_count = r->inputs.size(); 
+	fwrite(&header, sizeof(header), 1, f); 
+	fwrite(r->inputs.data(), sizeof(ReplayInput), r->inputs.size(), f); 
+	fclose(f); 
+	return true; 
+}
+
+bool load_replay(Replay *r, const char *path) {
+	FILE *f = fopen(path, "rb"); 
+	if(f == NULL) {
+		printf("Unable to open replay %s\n", path); 
+		return false; 
+	}
+	fseek(f, 0, SEEK_END); 
+	long size = ftell(f); 
+	fseek(f, 0, SEEK_SET); 
+	ReplayHeader header; 
+	bool valid = fread(&header, sizeof(header), 1, f) == 1 && memcmp(header.magic, REPLAY_MAGIC, 4) == 0 &&
+					header.version == REPLAY_VERSION && size == sizeof(header) + header.tick_count*sizeof(ReplayInput); 
+	if(valid) {
+		r->inputs.resize(header.tick_count); 
+		valid = fread(r->inputs.data(), sizeof(ReplayInput), header.tick_count, f) == header.tick_count; 
+	}
+	fclose(f); 
+	if(!valid) {
+		printf("%s is not a version %d replay\n", path, REPLAY_VERSION); 
+		r->inputs.clear(); 
+	}
+	return valid; 
+}
@@ -0,0 +1,47 @@
+#ifndef HEADERFILE_REPLAY
+#define HEADERFILE_REPLAY
+
+#include <stdint.h>
+#include <vector>
+#include "inputs.hpp"
+
+/*
+A recorded session: the player's input for every simulation tick, starting from setup_session.
+The simulation is deterministic given its input, so replaying the ticks rebuilds the session
+frame for frame. Saved as a ReplayHeader followed by tick_count ReplayInputs.
+*/
+
+const char REPLAY_MAGIC[4] = {'R', 'P', 'L', 'Y'}; 
+const uint32_t REPLAY_VERSION = 1; 
+
+struct ReplayHeader {
+	char magic[4]; 
+	uint32_t version; 
+	uint32_t tick_count; 
+}; 
+
+enum ReplayButtons {
+	REPLAY_MOUSE = 1,
+	REPLAY_RIGHT_MOUSE = 2,
+	REPLAY_J = 4,
+}; 
+
+struct ReplayInput {
+	int8_t x, y; 
+	uint8_t buttons; //ReplayButtons held.
+	uint8_t padding; 
+	int16_t mouse_x, mouse_y; 
+}; 
+
+struct Replay {
+	std::vector<ReplayInput> inputs; 
+}; 
+
+void record_input(Replay *r, const InputState *s); 
+//Input of tick, with nothing held past the end of the recording.
+InputState replay_input(const Replay *r, int tick); 
+bool save_replay(const Replay *r, const char *path); 
+//Returns false, with a message, if path is missing or not a replay.
+bool load_replay(Replay *r, const char *path); 
+
+#endif
@@ -0,0 +1,54 @@
+#include "scene_render.hpp"
+
+void render_snapshot(const RenderSnapshot *s, double alpha, Camera camera, SpriteSheet *sheet, 
+						ChunkTextures *ct, SpriteBatch *batch) {
+	//Clear screen
+	SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF ); 
+	SDL_RenderClear( gRenderer ); 
+
+	//Render tiles of chunks in view, each from its baked texture. 
+	for (int i = 0; i < s->chunks.size(); i++) {
+		render_chunk(ct, &s->chunks[i], camera); 
+	}
+
+	//Render entities and their healthbars. 
+	for (int i = 0; i < s->entities.size(); i++) {
+		const SnapshotEntity *e = &s->entities[i]; 
+		glm::dvec2 pos = glm::mix(e->prev_pos, e->pos, alpha); 
+		SDL_Rect sprite_dest = toRect(pos, e->dim, camera); 
+		batchSprite(batch, LAYER_ENTITIES, *sheet->getSprite(e->sprite), &sprite_dest, 0); 
+
+		if(e->max_health > 0) {
+			glm::dvec2 bar_dim = glm::dvec2(e->dim.x, e->dim.x / 8); 
+			glm::dvec2 bar_pos = glm::dvec2(0, 0.1+e->dim.y); 
+			SDL_Rect bar_dest = toRect(pos + bar_pos, bar_dim, camera); 
+			batchHealthbar(batch, LAYER_HEALTHBARS, e->health, e->max_health, bar_dest); 
+		}
+	}
+
+	//Render player healthbar
+	if(s->player_max_health > 0) {
+		SDL_Rect bar_dest = {0, 0, 100, 12}; 
+		batchHealthbar(batch, LAYER_HUD, s->player_health, s->player_max_health, bar_dest); 
+	}
+
+	//Render hitboxes and hurtboxes
+	for (int i = 0; i < s->hitboxes.size(); i++) {
+		SDL_Rect hitbox_dest = toRect(s->hitboxes[i].pos, s->hitboxes[i].dim, camera); 
+		batchDrawRect(batch, LAYER_HITBOXES, &hitbox_dest, SDL_Color {0, 128, 0, 255}); 
+	}
+	for (int i = 0; i < s->hurtboxes.size(); i++) {
+		SDL_Rect hurtbox_dest = toRect(s->hurtboxes[i].pos, s->hurtboxes[i].dim, camera); 
+		batchDrawRect(batch, LAYER_HITBOXES, &hurtbox_dest, SDL_Color {128, 0, 0, 255}); 
+	}
+
+	//Render particles
+	for (int i = 0; i < s->particles.size(); i++) {
+		const SnapshotParticle *p = &s->particles[i]; 
+		glm::dvec2 pos = glm::dvec2(p->prev_x + (p->x - p->prev_x)*alpha, p->prev_y + (p->y - p->prev_y)*alpha); 
+		SDL_Rect particle_dest = toRect(pos, glm::dvec2(p->w, p->h), camera); 
+		const Sprite *sprite = sheet->getSprite(p->sprite); 
+		batchSprite(batch, LAYER_PARTICLES, *sprite, &particle_dest, p->anim_step % sprite->frames); 
+	}
+	flushSpriteBatch(batch); 
+}
@@ -0,0 +1,14 @@
+#ifndef HEADERFILE_SCENE_RENDER
+#define HEADERFILE_SCENE_RENDER
+
+#include "game_world.hpp"
+#include "renderer.hpp"
+#include "chunk_render.hpp"
+#include "simulation.hpp"
+
+//Clears the screen and draws s, alpha of the way from the tick before it to its own. Chunks are
+//copied from their baked textures and everything else goes through batch. Doesn't present.
+void render_snapshot(const RenderSnapshot *s, double alpha, Camera camera, SpriteSheet *sheet,
+						ChunkTextures *ct, SpriteBatch *batch); 
+
+#endif
@@ -0,0 +1,339 @@
+#include "simulation.hpp"
+#include <stdio.h>
+#include <algorithm>
+#include "particle.hpp"
+#include "combat.hpp"
+#include "ai.hpp"
+
+void setup_session(Gamestate *g) {
+	g->main_chunk->tiles[0].tile_id = 1; 
+	g->main_chunk->tiles[1].tile_id = 2; 
+	g->main_chunk->tiles[37].tile_id = 1; 
+
+	//Main player is first entry in player_data
+	RollbackECS *ecs = g->ecs; 
+	Entity player = {entity_id:0, pos: glm::dvec2(5, 5), vel: glm::dvec2(0, 0), dim: glm::dvec2(0.5, 0.5), mass:1.0, num_contacts:0}; 
+	player.entity_id = ecs->push_player(); 
+	ecs->entities[ecs->entity_map[player.entity_id]] = player; 
+	ecs->push_firefly(glm::dvec2(8, 8)); 
+}
+
+void simulate_tick(Gamestate *g, InputState input, Camera camera, std::vector<BlockIndices> *block_indices) {
+	RollbackECS *ecs = g->ecs; 
+	int pid = ecs->player_data[0].entity_id; 
+	Entity *p = &ecs->entities[pid]; 
+
+	//Keep where everything was before this tick, so rendering can interpolate. 
+	for (int i = 0; i < ecs->entities.size(); i++) {
+		Entity *e = &ecs->entities[i]; 
+		e->prev_pos = e->pos; 
+		e->prev_frame = g->frame; 
+	}
+
+	updateInputs(input, &ecs->player_data[ecs->player_map[0]]); 
+
+	g->hurtboxes.clear(); 
+	g->hitboxes.clear(); 
+	g->hits.clear(); 
+
+	//Step
+	// Place blocks
+	// Filter tile contacts
+	// Apply input accelerations. 
+	// Apply contact contraints. 
+	// Calculate candidate positions. 
+	// Detect and resolve collisions. 
+	// Generate particles
+
+	// printf("getting blocks\n"); 
+	//Place blocks
+	PlayerData *pd = &ecs->player_data[ecs->player_map[0]]; 
+	pd->fire_cooldown -= 1; 
+
+	if(pd->inp.right_mouse_down) {
+		glm::dvec2 mouse_s = toPoint(pd->prev_inp.mouse_pos, camera); 
+		glm::dvec2 mouse_e = toPoint(pd->inp.mouse_pos, camera); 
+		if(!pd->prev_inp.mouse_down) {
+			mouse_e = mouse_s; 
+		}
+		block_indices->clear(); 
+		listIntersectingSquares(mouse_s, mouse_e, block_indices); 
+		for (int i = 0; i < block_indices->size(); i++) {
+			BlockIndices t = (*block_indices)[i]; 
+			if(t.row >= 0 && t.row < CHUNK_TILES && t.col >= 0 && t.col < CHUNK_TILES) {
+				//printf("Placing tile %d, %d\n", t.row, t.col);
+				t.chunk_row = 0; t.chunk_col = 0; 
+				queue_tile_edit(g->world, t, Tile {1, 0}); 
+			}
+		}
+	}
+	int applied = apply_tile_edits(g->world, g->frame); //Journaled so rollback covers terrain. 
+	std::vector<TileEdit> *edits = &g->world->journal.edits; 
+	flow_tiles_changed(&g->flow_fields, g->world, edits->data() + edits->size() - applied, applied); 
+	invalidate_path_graphs(g->pathfinder, &g->world->journal.touched); 
+	g->pathfinder->results.clear(); 
+	update_pathfinder(g->pathfinder, g->world, PATH_TICK_BUDGET); 
+
+	if(pd->inp.mouse_down && pd->fire_cooldown <= 0) {
+		pd->fire_cooldown = 10; 
+		glm::dvec2 mouse_e = toPoint(pd->inp.mouse_pos, camera); 
+		glm::dvec2 dir = mouse_e - p->pos; 
+		dir = 0.3 * dir / glm::length(dir); 
+		glm::dvec2 fp = 4.0*dir + p->pos; 
+		int fid = ecs->push_fireball(fp, dir); //TODO Replace with queue to make sure pushes happen between frames. 
+		ecs->ai_data[ecs->ai_map[fid]].data.fa.attack_id = g->next_attack_id++; 
+		AIData fb = ecs->ai_data[ecs->ai_map[fid]]; 
+		printf("New fireball data\n id %d, eid %d, step %d, lifespan %d\n", fid, fb.entity_id, 
+						fb.data.fa.step, fb.data.fa.lifespan); 
+	}
+	g->flow_targets.clear(); 
+	for (int i = 0; i < ecs->player_data.size(); i++) {
+		int eid = ecs->player_data[i].entity_id; 
+		if(ecs->player_map[eid] == i && ecs->entity_map[eid] >= 0) {
+			Entity *e = &ecs->entities[ecs->entity_map[eid]]; 
+			g->flow_targets.push_back(FlowTarget {eid, e->pos + e->dim * 0.5}); 
+		}
+	}
+	update_flow_fields(&g->flow_fields, g->world, g->flow_targets.data(), 
+						g->flow_targets.size(), g->frame); 
+	// printf("len ai %d\n", ecs->ai_data.size()); 
+	run_ai(g); 
+
+	// printf("entity physics\n"); 
+	//Physics loop
+	for (int i = 0; i < ecs->entities.size(); i++) {
+		Entity *e = &ecs->entities[i]; 
+		int eid = e->entity_id; 
+		if(ecs->entity_map[eid] != i) {
+			continue; 
+		}
+		filterTileContacts(e, block_indices, g->main_chunk); 
+	}
+
+	for (int i = 0; i < ecs->player_data.size(); i++) {
+		PlayerData *p = &ecs->player_data[i]; 
+		int entity_id = p->entity_id; 
+		Entity *e = &ecs->entities[ecs->entity_map[entity_id]]; 
+		player_physics_update(e, p, g); 
+	}
+	
+	//Tile physics solver for all entities. 
+	for (int i = 0; i < ecs->entities.size(); i++) {
+		Entity *e = &ecs->entities[i]; 
+		int eid = e->entity_id; 
+		if(ecs->entity_map[eid] != i) {
+			continue; 
+		}
+		tilePhysics(e, block_indices, g->main_chunk); 
+		spatial_update(&g->entity_index, eid, e->pos + e->dim / 2.0, g->frame); 
+	}
+	spatial_remove_stale(&g->entity_index, g->frame); 
+
+	//Keep the chunks around players and under live entities resident, then evict past the budget. 
+	World *w = g->world; 
+	for (int i = 0; i < ecs->player_data.size(); i++) {
+		int eid = ecs->player_data[i].entity_id; 
+		if(ecs->player_map[eid] == i && ecs->entity_map[eid] >= 0) {
+			Entity *e = &ecs->entities[ecs->entity_map[eid]]; 
+			pin_chunk_ring(w, pos2c(e->pos + e->dim * 0.5), ACTIVE_CHUNK_RADIUS); 
+		}
+	}
+	for (int i = 0; i < ecs->entities.size(); i++) {
+		Entity *e = &ecs->entities[i]; 
+		if(ecs->entity_map[e->entity_id] == i) {
+			pin_chunk_at(w, e->pos + e->dim * 0.5); 
+		}
+	}
+	g->main_chunk->pin_tick = w->cache.tick; //Physics holds it directly, so it must never be freed. 
+	update_chunk_cache(w); 
+
+	//Broadcast player hitbox
+	Hitbox h = {id: g->hitboxes.count, parent_id: pid, pos: p->pos, dim: p->dim}; 
+	g->hitboxes.push(h); 
+
+	//Broadcast player hurtbox
+	if(input.j && !pd->prev_inp.j) {
+		pd->attack_id = g->next_attack_id++; 
+	}
+	if(input.j) {
+		glm::dvec2 hurt_dim = glm::dvec2(2, 2); 
+		glm::dvec2 hurt_pos = p->pos + glm::dvec2(1, 1); 
+		Hurtbox h = {parent_id: p->entity_id, pos: hurt_pos, 
+		dim: hurt_dim, weight: 1, power: 3, attack_id: pd->attack_id, lifetime: PLAYER_ATTACK_LIFETIME}; 
+		g->hurtboxes.push(h); 
+	}
+
+	// printf("running hitboxes\n"); 
+	g->hit_registry.expire(g->frame); 
+	addHits(&g->hurtboxes, &g->hitboxes, &g->hits, &g->combat_grid, 
+			&g->hit_registry, g->frame); 
+	if(g->hits.size() > 0) {
+		printf("%d hits detected\n", g->hits.size()); 
+	}
+	resolve_hits(g); 
+
+	for (int i = 0; i < ecs->health_data.size(); i++) {
+		HealthData *h = &ecs->health_data[i]; 
+		if(h->health >= h->max_health) {
+			h->health = h->max_health; 
+		} else if (h->health > h->max_health - h->buffer_health) {
+			h->health += h->buffer_regen; 
+		} else {
+			h->health += h->health_regen; 
+		}
+		if(h->health <= 0) {
+			ecs->delete_entity(h->entity_id); 
+		}
+	}
+
+	//Follow up on attack hits
+	for (int i = 0; i < ecs->ai_data.size(); i++) {
+		AIData *ad = &ecs->ai_data[i]; 
+		int eid = ad->entity_id; 
+		if(ecs->ai_map[eid] != i) {
+			continue; 
+		}
+		if(ecs->entity_map[eid] >= 0) {
+			Entity *e = &ecs->entities[ecs->entity_map[eid]]; 
+			if(ad->type == FIREBALL && (e->flags & (ATTACKER_HIT | TARGET_HIT))) {
+				ecs->delete_entity(eid); 
+			}
+			e->flags = e->flags & (~(ATTACKER_HIT | TARGET_HIT)); 
+		}
+	}
+
+	ecs->roll_save(); //Save current components, switch to consolidated components for next round. 
+	g->frame += 1; 
+
+	update_particles(g->particles); 
+
+}
+
+void take_snapshot(Gamestate *g, Camera camera, RenderSnapshot *s, std::vector<int> *visible) {
+	RollbackECS *ecs = g->ecs; 
+	s->frame = g->frame; 
+	//The renderer's camera trails this one by up to a tick, so copy a margin past the view.
+	glm::dvec2 margin = glm::dvec2(CULL_MARGIN, CULL_MARGIN); 
+	glm::dvec2 view_lo, view_hi; 
+	cameraBounds(camera, &view_lo, &view_hi); 
+	view_lo -= margin; 
+	view_hi += margin; 
+
+	int player_id = ecs->player_data[0].entity_id; 
+	Entity *pe = &ecs->entities[ecs->entity_map[player_id]]; 
+	s->focus = pe->pos; 
+	s->prev_focus = renderPos(pe, g->frame, 0); 
+	HealthData *ph = &ecs->health_data[ecs->health_map[player_id]]; 
+	s->player_health = ph->health; 
+	s->player_max_health = ph->max_health; 
+
+	s->chunks.clear(); 
+	ChunkIndices chunk_lo = pos2c(view_lo); 
+	ChunkIndices chunk_hi = pos2c(view_hi); 
+	for (int row = chunk_lo.row; row <= chunk_hi.row; row++) {
+		for (int col = chunk_lo.col; col <= chunk_hi.col; col++) {
+			Chunk *chunk = query_chunk(g->world, ChunkIndices {row, col}); 
+			if(chunk != nullptr) {
+				s->chunks.push_back(*chunk); 
+			}
+		}
+	}
+
+	//The index holds centers. The view was already widened by CULL_MARGIN, which covers the half size of any entity.
+	s->entities.clear(); 
+	visible->resize(g->entity_index.count); 
+	int num_visible = spatial_query_aabb(&g->entity_index, view_lo, view_hi, visible->data(), visible->size()); 
+	for (int v = 0; v < num_visible; v++) {
+		int eid = (*visible)[v]; 
+		if(ecs->entity_map[eid] < 0) {
+			continue; 
+		}
+		Entity *e = &ecs->entities[ecs->entity_map[eid]]; 
+		if(!boxInView(view_lo, view_hi, e->pos, e->dim)) {
+			continue; 
+		}
+		SnapshotEntity se = {e->pos, renderPos(e, g->frame, 0), e->dim,
+								e->sprite != SPRITE_NONE ? e->sprite : g->sprites.body, 0, 0}; 
+		if(ecs->health_map[eid] >= 0 && eid != player_id) {
+			HealthData *h = &ecs->health_data[ecs->health_map[eid]]; 
+			se.health = h->health; 
+			se.max_health = h->max_health; 
+		}
+		s->entities.push_back(se); 
+	}
+
+	s->hitboxes.clear(); 
+	for (int i = 0; i < g->hitboxes.count; i++) {
+		HitboxBuffer *h = &g->hitboxes; 
+		SnapshotBox b = {glm::dvec2(h->x[i], h->y[i]), glm::dvec2(h->w[i], h->h[i])}; 
+		if(boxInView(view_lo, view_hi, b.pos, b.dim)) s->hitboxes.push_back(b); 
+	}
+	s->hurtboxes.clear(); 
+	for (int i = 0; i < g->hurtboxes.count; i++) {
+		HurtboxBuffer *h = &g->hurtboxes; 
+		SnapshotBox b = {glm::dvec2(h->x[i], h->y[i]), glm::dvec2(h->w[i], h->h[i])}; 
+		if(boxInView(view_lo, view_hi, b.pos, b.dim)) s->hurtboxes.push_back(b); 
+	}
+
+	//Particles are culled without branches, so the test vectorizes. 
+	ParticleSystem *ps = g->particles; 
+	s->particles.resize(ps->count); 
+	float lo_x = view_lo.x, lo_y = view_lo.y, hi_x = view_hi.x, hi_y = view_hi.y; 
+	int num_particles = 0; 
+	for (int i = 0; i < ps->count; i++) {
+		s->particles[num_particles] = SnapshotParticle {ps->x[i], ps->y[i], ps->prev_x[i], ps->prev_y[i], ps->w[i], ps->h[i], 
+											ps->sprite[i], (uint16_t) (ps->age[i] / ps->change_interval[i])}; 
+		num_particles += ps->x[i] <= hi_x && ps->y[i] <= hi_y && ps->x[i] + ps->w[i] >= lo_x && ps->y[i] + ps->h[i] >= lo_y; 
+	}
+	s->particles.resize(num_particles); 
+}
+
+SimThread::SimThread(Gamestate *g, Camera camera, glm::dvec2 camera_offset) : running(false), updates(0) {
+	gamestate = g; 
+	recording = NULL; 
+	this->camera = camera; 
+	this->camera_offset = camera_offset; 
+}
+
+void SimThread::start() {
+	running = true; 
+	thread = std::thread([this]() {
+		RollbackECS *ecs = gamestate->ecs; 
+		Uint32 next = SDL_GetTicks(); 
+		while(running) {
+			Uint32 now = SDL_GetTicks(); 
+			if((int32_t) (next - now) > 0) {
+				SDL_Delay(next - now); 
+				continue; 
+			}
+			inputs.take(); 
+			Entity *pe = &ecs->entities[ecs->entity_map[ecs->player_data[0].entity_id]]; 
+			camera.pos = pe->pos - camera_offset; 
+			if(recording != NULL) {
+				record_input(recording, inputs.read_slot()); 
+			}
+			simulate_tick(gamestate, *inputs.read_slot(), camera, &block_indices); 
+
+			pe = &ecs->entities[ecs->entity_map[ecs->player_data[0].entity_id]]; 
+			camera.pos = pe->pos - camera_offset; 
+			RenderSnapshot *s = snapshots.write_slot(); 
+			take_snapshot(gamestate, camera, s, &visible); 
+			s->ticks = SDL_GetTicks(); 
+			snapshots.publish(); 
+			updates += 1; 
+
+			next += TICKS_PER_UPDATE; 
+			//After a long stall, skip ahead rather than running the backlog back to back.
+			if((int32_t) (now - next) > 5*TICKS_PER_UPDATE) {
+				next = now; 
+			}
+		}
+	}); 
+}
+
+void SimThread::stop() {
+	running = false; 
+	if(thread.joinable()) {
+		thread.join(); 
+	}
+}
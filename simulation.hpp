@@ -0,0 +1,91 @@
+#ifndef HEADERFILE_SIMULATION
+#define HEADERFILE_SIMULATION
+
+#include <SDL.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <glm/glm.hpp>
+#include "chunk.hpp"
+#include "game_world.hpp"
+#include "inputs.hpp"
+#include "renderer.hpp"
+#include "triple_buffer.hpp"
+#include "replay.hpp"
+
+const int UPDATES_PER_SECOND = 50; 
+const int TICKS_PER_UPDATE = 1000 / UPDATES_PER_SECOND; 
+const int ACTIVE_CHUNK_RADIUS = 1; //Chunks around each player kept loaded and pinned, e.g. 1 for a 3x3 ring. 
+const double CULL_MARGIN = 4; //Units past the view an entity's center can be while its box is still in view.
+
+/*
+Everything the renderer needs from one simulation tick, copied out so drawing never reads
+live game state. Positions come in pairs, from the tick before and this one, so the renderer
+can interpolate between them. Only what's near the camera is copied.
+*/
+struct SnapshotEntity {
+	glm::dvec2 pos; 
+	glm::dvec2 prev_pos; 
+	glm::dvec2 dim; 
+	SpriteHandle sprite; 
+	int health; 
+	int max_health; //0 for no healthbar.
+}; 
+
+struct SnapshotParticle {
+	float x, y; 
+	float prev_x, prev_y; 
+	float w, h; 
+	SpriteHandle sprite; 
+	uint16_t anim_step; //Frames of the sprite's animation since it was spawned.
+}; 
+
+struct SnapshotBox {
+	glm::dvec2 pos; 
+	glm::dvec2 dim; 
+}; 
+
+struct RenderSnapshot {
+	uint32_t frame; //Ticks simulated, 0 until the first snapshot is published.
+	Uint32 ticks; //SDL_GetTicks when published.
+	glm::dvec2 focus; //Camera target, the player.
+	glm::dvec2 prev_focus; 
+	int player_health, player_max_health; 
+	std::vector<Chunk> chunks; //Copies of the loaded chunks in view.
+	std::vector<SnapshotEntity> entities; 
+	std::vector<SnapshotParticle> particles; 
+	std::vector<SnapshotBox> hitboxes; 
+	std::vector<SnapshotBox> hurtboxes; 
+}; 
+
+//Builds the starting world and spawns the player, the same way for new games and replays.
+void setup_session(Gamestate *g); 
+//Advances g by one tick with the given player input. camera converts mouse positions to world space.
+void simulate_tick(Gamestate *g, InputState input, Camera camera, std::vector<BlockIndices> *block_indices); 
+//Copies what's around camera into s. visible is scratch for culling.
+void take_snapshot(Gamestate *g, Camera camera, RenderSnapshot *s, std::vector<int> *visible); 
+
+/*
+Runs the simulation on its own thread at UPDATES_PER_SECOND. The main thread publishes input
+into inputs and takes snapshots, and the simulation thread does the reverse, so neither waits
+on the other. Once started, the gamestate belongs to the simulation thread until stop.
+*/
+struct SimThread {
+	Gamestate *gamestate; 
+	Camera camera; //Screen setup for mouse positions, follows the player.
+	glm::dvec2 camera_offset; 
+	std::vector<BlockIndices> block_indices; 
+	std::vector<int> visible; 
+	TripleBuffer<InputState> inputs; 
+	TripleBuffer<RenderSnapshot> snapshots; 
+	std::atomic<bool> running; 
+	std::atomic<int> updates; //Ticks simulated, for the UPS counter.
+	Replay *recording; //Gets every tick's input when set. Read it after stop.
+	std::thread thread; 
+
+	SimThread(Gamestate *g, Camera camera, glm::dvec2 camera_offset); 
+	void start(); 
+	void stop(); //Returns once the thread has exited.
+}; 
+
+#endif
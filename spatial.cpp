@@ -0,0 +1,181 @@
+#include "spatial.hpp"
+#include <math.h>
+#include <algorithm>
+
+static inline int floor_div(int a, int b) {
+    return a >= 0 ? a / b : -((-a - 1) / b) - 1; 
+}
+
+static inline int cell_coord(double x) {
+    return (int) floor(x / SPATIAL_CELL_WIDTH); 
+}
+
+SpatialIndex::SpatialIndex() {
+    count = 0; 
+}
+
+//Cell at global cell coordinates, created if create is set, else null when its chunk has none.
+//last caches the previous chunk so scans along a row of cells hash once per chunk.
+static SpatialCell* find_cell(SpatialIndex *s, int row, int col, bool create, ChunkIndices *last_c, SpatialChunk **last) {
+    ChunkIndices c = {floor_div(row, SPATIAL_CELLS), floor_div(col, SPATIAL_CELLS)}; 
+    if(*last == nullptr || !(c == *last_c)) {
+        *last_c = c;
+        if(create) {
+            if(s->chunks.empty()) {
+                s->lo = c; s->hi = c; 
+            }
+            s->lo = ChunkIndices {std::min(s->lo.row, c.row), std::min(s->lo.col, c.col)}; 
+            s->hi = ChunkIndices {std::max(s->hi.row, c.row), std::max(s->hi.col, c.col)}; 
+            *last = &s->chunks[c];
+        } else {
+            auto it = s->chunks.find(c); 
+            *last = it == s->chunks.end() ? nullptr : &it->second;
+        }
+        if(*last == nullptr) {
+            return nullptr; 
+        }
+    }
+    int r = row - c.row*SPATIAL_CELLS; int cl = col - c.col*SPATIAL_CELLS; 
+    return &(*last)->cells[r*SPATIAL_CELLS + cl]; 
+}
+
+static void cell_remove(SpatialIndex *s, SpatialSlot *slot) {
+    SpatialCell *cell = slot->cell; 
+    int i = slot->index; 
+    int last = cell->ids.size() - 1; 
+    if(i != last) {
+        cell->ids[i] = cell->ids[last]; cell->x[i] = cell->x[last]; cell->y[i] = cell->y[last]; 
+        s->slots[cell->ids[i]].index = i; 
+    }
+    cell->ids.pop_back(); cell->x.pop_back(); cell->y.pop_back(); 
+    slot->cell = nullptr; 
+}
+
+void spatial_update(SpatialIndex *s, int id, glm::dvec2 p, uint32_t stamp) {
+    if(id >= s->slots.size()) {
+        s->slots.resize(id + 1, SpatialSlot {nullptr, 0, 0, 0, 0}); 
+    }
+    SpatialSlot *slot = &s->slots[id]; 
+    slot->stamp = stamp; 
+    int row = cell_coord(p.y); int col = cell_coord(p.x); 
+    if(slot->cell != nullptr && slot->cell_row == row && slot->cell_col == col) {
+        slot->cell->x[slot->index] = p.x; slot->cell->y[slot->index] = p.y; 
+        return; 
+    }
+    if(slot->cell != nullptr) {
+        cell_remove(s, slot); 
+    } else {
+        s->count += 1; 
+    }
+    ChunkIndices last_c; 
+    SpatialChunk *last = nullptr; 
+    SpatialCell *cell = find_cell(s, row, col, true, &last_c, &last); 
+    slot->cell = cell; 
+    slot->cell_row = row; slot->cell_col = col; 
+    slot->index = cell->ids.size(); 
+    cell->ids.push_back(id); cell->x.push_back(p.x); cell->y.push_back(p.y); 
+}
+
+void spatial_remove(SpatialIndex *s, int id) {
+    if(id < s->slots.size() && s->slots[id].cell != nullptr) {
+        cell_remove(s, &s->slots[id]); 
+        s->count -= 1; 
+    }
+}
+
+void spatial_remove_stale(SpatialIndex *s, uint32_t stamp) {
+    for (int id = 0; id < s->slots.size(); id++) {
+        if(s->slots[id].cell != nullptr && s->slots[id].stamp != stamp) {
+            spatial_remove(s, id); 
+        }
+    }
+}
+
+int spatial_query_aabb(SpatialIndex *s, glm::dvec2 lo, glm::dvec2 hi, int *out, int max_out) {
+    int n = 0; 
+    ChunkIndices last_c; 
+    SpatialChunk *last = nullptr; 
+    for (int row = cell_coord(lo.y); row <= cell_coord(hi.y); row++) {
+        for (int col = cell_coord(lo.x); col <= cell_coord(hi.x); col++) {
+            SpatialCell *cell = find_cell(s, row, col, false, &last_c, &last); 
+            if(cell == nullptr) continue; 
+            for (int i = 0; i < cell->ids.size(); i++) {
+                if(cell->x[i] >= lo.x && cell->x[i] <= hi.x && cell->y[i] >= lo.y && cell->y[i] <= hi.y) {
+                    if(n == max_out) return n; 
+                    out[n++] = cell->ids[i]; 
+                }
+            }
+        }
+    }
+    return n; 
+}
+
+int spatial_query_radius(SpatialIndex *s, glm::dvec2 center, double radius, int *out, int max_out) {
+    int n = 0; 
+    double r2 = radius * radius; 
+    ChunkIndices last_c; 
+    SpatialChunk *last = nullptr; 
+    for (int row = cell_coord(center.y - radius); row <= cell_coord(center.y + radius); row++) {
+        for (int col = cell_coord(center.x - radius); col <= cell_coord(center.x + radius); col++) {
+            SpatialCell *cell = find_cell(s, row, col, false, &last_c, &last); 
+            if(cell == nullptr) continue; 
+            for (int i = 0; i < cell->ids.size(); i++) {
+                double dx = cell->x[i] - center.x; double dy = cell->y[i] - center.y; 
+                if(dx*dx + dy*dy <= r2) {
+                    if(n == max_out) return n; 
+                    out[n++] = cell->ids[i]; 
+                }
+            }
+        }
+    }
+    return n; 
+}
+
+//Searches rings of cells outward from center's cell, keeping the k best in out sorted by distance.
+//Stops once the ring's nearest possible point is farther than the current kth best.
+int spatial_query_nearest(SpatialIndex *s, glm::dvec2 center, int k, double max_radius, int *out) {
+    if(k <= 0) return 0; 
+    if(s->knn_dist.size() < k) {
+        s->knn_dist.resize(k); 
+    }
+    double *best = s->knn_dist.data(); 
+    int n = 0; 
+    double limit = max_radius * max_radius; 
+    int row0 = cell_coord(center.y); int col0 = cell_coord(center.x); 
+    if(s->chunks.empty()) return 0; 
+    //Rings past every indexed chunk are empty, which also bounds the search for an unlimited radius.
+    int max_ring = std::max({row0 - s->lo.row*SPATIAL_CELLS, (s->hi.row + 1)*SPATIAL_CELLS - 1 - row0,
+                            col0 - s->lo.col*SPATIAL_CELLS, (s->hi.col + 1)*SPATIAL_CELLS - 1 - col0}); 
+    if(max_radius / SPATIAL_CELL_WIDTH + 1 < max_ring) {
+        max_ring = (int) ceil(max_radius / SPATIAL_CELL_WIDTH) + 1; 
+    }
+    ChunkIndices last_c; 
+    SpatialChunk *last = nullptr; 
+    for (int ring = 0; ring <= max_ring; ring++) {
+        //Nearest any cell in this ring can be.
+        double ring_d = std::max(0.0, (ring - 1) * SPATIAL_CELL_WIDTH); 
+        if(ring_d * ring_d > limit) break; 
+        for (int row = row0 - ring; row <= row0 + ring; row++) {
+            bool edge_row = row == row0 - ring || row == row0 + ring; 
+            int step = edge_row ? 1 : 2*ring; 
+            for (int col = col0 - ring; col <= col0 + ring; col += std::max(step, 1)) {
+                SpatialCell *cell = find_cell(s, row, col, false, &last_c, &last); 
+                if(cell == nullptr) continue; 
+                for (int i = 0; i < cell->ids.size(); i++) {
+                    double dx = cell->x[i] - center.x; double dy = cell->y[i] - center.y; 
+                    double d2 = dx*dx + dy*dy; 
+                    if(d2 > limit) continue; 
+                    //Insertion into the sorted best list. k is small.
+                    int j = n < k ? n++ : k - 1; 
+                    while (j > 0 && best[j-1] > d2) {
+                        best[j] = best[j-1]; out[j] = out[j-1]; 
+                        j--; 
+                    }
+                    best[j] = d2; out[j] = cell->ids[i]; 
+                    if(n == k) limit = best[k-1]; 
+                }
+            }
+        }
+    }
+    return n; 
+}
@@ -0,0 +1,58 @@
+#ifndef HEADERFILE_SPATIAL
+#define HEADERFILE_SPATIAL
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <unordered_map>
+#include "chunk.hpp"
+
+/*
+Entity positions bucketed by chunk, then by fixed cells inside the chunk. Updates are
+incremental: an entity that stays in its cell only has its position rewritten, and one that
+changes cell is swap-removed from the old cell and appended to the new one. Queries write
+entity ids into a caller buffer and return the count, so they never allocate.
+*/
+
+const int SPATIAL_CELL_TILES = 8; //Cell side in tiles. Divides CHUNK_TILES.
+const int SPATIAL_CELLS = CHUNK_TILES / SPATIAL_CELL_TILES; //Cells per chunk side.
+const double SPATIAL_CELL_WIDTH = SPATIAL_CELL_TILES * TILE_WIDTH; 
+
+struct SpatialCell {
+	std::vector<int> ids; 
+	std::vector<double> x, y; 
+}; 
+
+struct SpatialChunk {
+	SpatialCell cells[SPATIAL_CELLS*SPATIAL_CELLS]; 
+}; 
+
+//Where an entity is stored. Indexed by entity id.
+struct SpatialSlot {
+	SpatialCell *cell; //Null when the entity isn't indexed.
+	int cell_row, cell_col; //Global cell coordinates.
+	int index; //Position in cell's arrays.
+	uint32_t stamp; //Frame of the last update.
+}; 
+
+struct SpatialIndex {
+	std::unordered_map<ChunkIndices, SpatialChunk> chunks; 
+	std::vector<SpatialSlot> slots; 
+	std::vector<double> knn_dist; //Scratch for k nearest queries.
+	ChunkIndices lo, hi; //Bounds of chunks in the index.
+	int count; 
+	SpatialIndex(); 
+}; 
+
+//Inserts id at p, or moves it there if already indexed. stamp marks it as live for spatial_remove_stale.
+void spatial_update(SpatialIndex *s, int id, glm::dvec2 p, uint32_t stamp); 
+void spatial_remove(SpatialIndex *s, int id); 
+//Removes every entity whose last update wasn't stamped with stamp, e.g. entities deleted this tick.
+void spatial_remove_stale(SpatialIndex *s, uint32_t stamp); 
+
+//Each query writes up to max_out ids to out and returns how many were written.
+int spatial_query_radius(SpatialIndex *s, glm::dvec2 center, double radius, int *out, int max_out); 
+int spatial_query_aabb(SpatialIndex *s, glm::dvec2 lo, glm::dvec2 hi, int *out, int max_out); 
+//Up to k entities nearest center within max_radius, nearest first.
+int spatial_query_nearest(SpatialIndex *s, glm::dvec2 center, int k, double max_radius, int *out); 
+
+#endif
@@ -1,89 +1,465 @@
 #include "terrain.hpp"
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <thread>
+#include <algorithm>
 
 
-typedef glm::dvec2 vec; 
+//Seed offsets so each pipeline stage samples an independent noise field.
+static const uint32_t WARP_X_SEED = 0x51ED27u; 
+static const uint32_t WARP_Y_SEED = 0xA3C59Bu; 
+static const uint32_t SURFACE_SEED = 0x2F0B3Du; 
+static const uint32_t ORE_SEED = 0x7C1E4Fu; 
 
-void random_grid_vec(vec* grid, int height, int width) {
+//Mixes seed and lattice coordinates into 32 bits. Replaces rand() so noise doesn't depend on call order.
+static inline uint32_t hash_lattice(uint32_t seed, int x, int y) {
+    uint32_t h = seed * 0x9E3779B1u; 
+    h ^= (uint32_t) x * 0x85EBCA77u; 
+    h = (h << 13) | (h >> 19); 
+    h ^= (uint32_t) y * 0xC2B2AE3Du; 
+    h ^= h >> 16; h *= 0x7FEB352Du; 
+    h ^= h >> 15; h *= 0x846CA68Bu; 
+    h ^= h >> 16; 
+    return h; 
+}
+
+//Gradient is built from the hash bits instead of a table lookup, which would need a gather.
+static inline float lattice_dot(uint32_t seed, int x, int y, float dx, float dy) {
+    uint32_t h = hash_lattice(seed, x, y); 
+    float gx = (float) (int) (h & 0xFFFF) - 32768.0f; 
+    float gy = (float) (int) (h >> 16) - 32768.0f; 
+    return (gx*dx + gy*dy) * (1.0f / 32768.0f); 
+}
+
+static inline float fade(float t) {
+    return t*t*t*(t*(t*6 - 15) + 10); 
+}
+
+void noise_strip(const float* x, const float* y, float* out, int n, float freq, float amp, uint32_t seed) {
+    for (int i = 0; i < n; i++) {
+        float px = x[i]*freq; float py = y[i]*freq; 
+        int x0 = (int) px; x0 -= px < x0; //Floor without a libm call.
+        int y0 = (int) py; y0 -= py < y0; 
+        float fx = px - x0; float fy = py - y0; //Position inside lattice cell.
+
+        float a0 = lattice_dot(seed, x0, y0, fx, fy); 
+        float a1 = lattice_dot(seed, x0+1, y0, fx-1, fy); 
+        float a2 = lattice_dot(seed, x0+1, y0+1, fx-1, fy-1); 
+        float a3 = lattice_dot(seed, x0, y0+1, fx, fy-1); 
+
+        float u = fade(fx); float v = fade(fy); 
+        float bottom = a0 + u*(a1 - a0); 
+        float top = a3 + u*(a2 - a3); 
+        out[i] += amp*(bottom + v*(top - bottom)); 
+    }
+}
+
+float gradient_noise(uint32_t seed, float x, float y) {
+    float out = 0; 
+    noise_strip(&x, &y, &out, 1, 1, 1, seed); 
+    return out; 
+}
+
+void fractal_noise_strip(const float* x, const float* y, float* out, int n, int octaves, float freq, 
+                            float lacunarity, float gain, uint32_t seed) {
+    float octave[CHUNK_TILES]; 
+    memset(octave, 0, n*sizeof(float)); 
+    float amp = 1; float amp_sum = 0; 
+    for (int o = 0; o < octaves; o++) {
+        noise_strip(x, y, octave, n, freq, amp, seed + o); 
+        amp_sum += amp; 
+        amp *= gain; 
+        freq *= lacunarity; 
+    }
+    mul_grid(1.0f / amp_sum, octave, 1, n); 
+    add_grid(out, octave, 1, 1, out, 1, n); 
+}
+
+void perlin_noise(float* grid, int height, int width, int row0, int col0, float cell_width, uint32_t seed) {
+    float xs[CHUNK_TILES]; float ys[CHUNK_TILES]; 
     for (int r = 0; r < height; r++) {
-        for (int c = 0; c < width; c++) {
-            vec v = vec(rand() % 1024, rand() % 1024); 
-            grid[r*width+c] = glm::normalize(v);  
+        for (int c0 = 0; c0 < width; c0 += CHUNK_TILES) {
+            int n = std::min(CHUNK_TILES, width - c0); 
+            for (int c = 0; c < n; c++) {
+                xs[c] = col0 + c0 + c + 0.5f; //Sample tile centers.
+                ys[c] = row0 + r + 0.5f; 
+            }
+            noise_strip(xs, ys, &grid[r*width + c0], n, 1.0f / cell_width, 1, seed); 
         }
-    } 
-}
-
-void perlin_noise(double* grid, int height, int width, int cell_height, int cell_width) {
-    int ph = (height / cell_height) + 1; int pw = (width / cell_width) + 1; 
-    vec* ggrid = (vec*) calloc(ph*pw, sizeof(vec));
-    random_grid_vec(ggrid, ph, pw);
-    for (int r = 0; r < ph-1; r++) {
-        for (int c = 0; c < pw-1; c++) {
-            for (int cr = 0; cr < cell_height; cr++) {
-                for (int cc = 0; cc < cell_width; cc++) {
-                    vec p = vec(cr, cc) + 0.5; //Grid cells are always (1x1)
-                    double fx = p.x/ ((double) cell_width);
-                    double fy = p.y / ((double) cell_height); 
-                    double i0 = (1-fx)*(1-fy); double i1 = (1-fx)*fy;
-                    double i2 = fx*fy; double i3 = fx*(1-fy);
-
-                    double a0 = glm::dot(ggrid[r*pw+c], p); 
-                    double a1 = glm::dot(ggrid[r*pw+c+1], p); 
-                    double a2 = glm::dot(ggrid[(r+1)*pw+c+1], p); 
-                    double a3 = glm::dot(ggrid[(r+1)*pw+c], p); 
-
-                    grid[(c*cell_width + cc) + (r*cell_height + cr)*width] += a0*i0+a1*i1+a2*i2+a3*i3; 
-                }
+    }
+}
+
+//Grids are flat, so both passes are a single unit stride loop.
+void add_grid(float* g1, float* g2, float alpha, float beta, float* gout, int height, int width) {
+    int n = height*width; 
+    for (int i = 0; i < n; i++) {
+        gout[i] = alpha*g1[i] + beta*g2[i]; 
+    }
+}
+void mul_grid(float alpha, float *grid, int height, int width) {
+    int n = height*width; 
+    for (int i = 0; i < n; i++) {
+        grid[i] = alpha*grid[i]; 
+    }
+}
+
+//Each row is processed as a set of CHUNK_TILES wide strips that stay in L1, 
+//so no stage makes its own sweep over the full chunk. 
+void gen_chunk_tiles(Chunk *chunk, uint32_t seed, const TerrainParams *tp) {
+    const int n = CHUNK_TILES; 
+    float xs[n], ys[n], wx[n], wy[n], density[n], ore[n], surface[n]; 
+    int row0 = chunk->row*CHUNK_TILES; int col0 = chunk->col*CHUNK_TILES; 
+
+    //Surface height only depends on the column. 
+    for (int c = 0; c < n; c++) {
+        xs[c] = col0 + c + 0.5f; 
+        ys[c] = 0; 
+        surface[c] = 0; 
+    }
+    fractal_noise_strip(xs, ys, surface, n, tp->surface_octaves, 1.0f / tp->surface_scale, 
+                        tp->lacunarity, tp->gain, seed ^ SURFACE_SEED); 
+    for (int c = 0; c < n; c++) {
+        surface[c] = tp->surface_height + tp->surface_amplitude*surface[c]; 
+    }
+
+    for (int r = 0; r < n; r++) {
+        float row = row0 + r; 
+        for (int c = 0; c < n; c++) {
+            xs[c] = col0 + c + 0.5f; 
+            ys[c] = row + 0.5f; 
+            wx[c] = 0; wy[c] = 0; density[c] = 0; ore[c] = 0; 
+        }
+        //Domain warp
+        fractal_noise_strip(xs, ys, wx, n, tp->warp_octaves, 1.0f / tp->warp_scale, tp->lacunarity, tp->gain, seed ^ WARP_X_SEED); 
+        fractal_noise_strip(xs, ys, wy, n, tp->warp_octaves, 1.0f / tp->warp_scale, tp->lacunarity, tp->gain, seed ^ WARP_Y_SEED); 
+        add_grid(xs, wx, 1, tp->warp_strength, xs, 1, n); 
+        add_grid(ys, wy, 1, tp->warp_strength, ys, 1, n); 
+
+        fractal_noise_strip(xs, ys, density, n, tp->octaves, 1.0f / tp->cell_width, tp->lacunarity, tp->gain, seed); 
+        noise_strip(xs, ys, ore, n, 1.0f / tp->ore_scale, 1, seed ^ ORE_SEED); 
+
+        //Threshold into ground, caves and ore. 
+        Tile *tiles = &chunk->tiles[r*n]; 
+        for (int c = 0; c < n; c++) {
+            bool solid = row < surface[c] && density[c] <= tp->cave_threshold; 
+            char id = ore[c] > tp->ore_threshold ? TILE_ORE : TILE_DIRT; 
+            tiles[c].tile_id = solid ? id : TILE_AIR; 
+            tiles[c].damage = 0; 
+        }
+    }
+}
+
+static Chunk* new_chunk(World *w, ChunkIndices c) {
+    Chunk *chunk = new Chunk; 
+    chunk->row = c.row; 
+    chunk->col = c.col; 
+    chunk->last_used = w->cache.tick; 
+    chunk->pin_tick = 0; 
+    chunk->dirty = false; 
+    return chunk; 
+}
+
+void gen_chunk(World *w, int chunk_row, int chunk_col) {
+    ChunkIndices c = {chunk_row, chunk_col}; 
+    if(w->chunks.find(c) != nullptr) {
+        return; 
+    }
+    Chunk *chunk = new_chunk(w, c); 
+    gen_chunk_tiles(chunk, w->seed, &w->terrain); 
+    w->chunks.insert(c, chunk); 
+}
+
+//Chunks are generated into a private array by worker threads, then inserted into w on the calling thread.
+//Each chunk only depends on its own coordinates and the seed, so the result is the same for any thread count.
+void gen_chunks(World *w, std::vector<ChunkIndices> *chunk_list) {
+    std::vector<Chunk*> pending; 
+    for (int i = 0; i < chunk_list->size(); i++) {
+        ChunkIndices c = chunk_list->at(i); 
+        if(w->chunks.find(c) != nullptr) {
+            continue; 
+        }
+        pending.push_back(new_chunk(w, c)); 
+    }
+
+    int num_threads = std::thread::hardware_concurrency(); 
+    if(num_threads <= 0) {
+        num_threads = 1; 
+    }
+    if(num_threads > pending.size()) {
+        num_threads = pending.size(); 
+    }
+    uint32_t seed = w->seed; 
+    const TerrainParams *tp = &w->terrain; 
+    std::vector<std::thread> workers; 
+    for (int t = 0; t < num_threads; t++) {
+        workers.push_back(std::thread([&pending, seed, tp, t, num_threads]() {
+            for (int i = t; i < pending.size(); i += num_threads) {
+                gen_chunk_tiles(pending[i], seed, tp); 
             }
+        })); 
+    }
+    for (int t = 0; t < workers.size(); t++) {
+        workers[t].join(); 
+    }
+
+    for (int i = 0; i < pending.size(); i++) {
+        ChunkIndices c = {pending[i]->row, pending[i]->col}; 
+        if(w->chunks.find(c) != nullptr) { //Duplicate in chunk_list.
+            delete pending[i]; 
+            continue; 
         }
+        w->chunks.insert(c, pending[i]); 
     }
 }
 
-void add_grid(double* g1, double* g2, double alpha, double beta, double* gout, int height, int width) {
-    for (int r = 0; r < height; r++) {
-        for (int c = 0; c < width; c++) {
-            gout[r*width + c] = alpha*g1[r*width + c] + beta*g2[r*width + c]; 
+//Brings back a chunk evicted dirty, either still queued for writing or already on disk. 
+static Chunk* restore_chunk(World *w, ChunkIndices c) {
+    Chunk *chunk = w->cache.rescue(c); 
+    if(chunk != nullptr) {
+        w->cache.stats.rescued += 1; 
+    } else {
+        chunk = new_chunk(w, c); 
+        if(!w->cache.read_saved(chunk)) {
+            delete chunk; 
+            return nullptr; 
         }
+        w->cache.stats.loaded += 1; 
     }
+    chunk->last_used = w->cache.tick; 
+    w->chunks.insert(c, chunk); 
+    return chunk; 
 }
-void mul_grid(double alpha, double *grid, int height, int width) {
-    for (int r = 0; r < height; r++) {
-        for (int c = 0; c < width; c++) {
-            grid[r*width + c] = alpha*grid[r*width+c]; 
+
+Chunk* load_chunk(World *w, ChunkIndices c) {
+    Chunk *chunk = w->chunks.find(c); 
+    if(chunk != nullptr) {
+        w->cache.stats.hits += 1; 
+        chunk->last_used = w->cache.tick; 
+        return chunk; 
+    }
+    w->cache.stats.misses += 1; 
+    chunk = restore_chunk(w, c); 
+    if(chunk == nullptr) {
+        gen_chunk(w, c.row, c.col); 
+        chunk = w->chunks.find(c); 
+    }
+    return chunk; 
+}
+
+void load_chunks(World *w, std::vector<ChunkIndices> *chunk_list) {
+    std::vector<ChunkIndices> generate; 
+    for (int i = 0; i < chunk_list->size(); i++) {
+        ChunkIndices c = chunk_list->at(i); 
+        Chunk *chunk = w->chunks.find(c); 
+        if(chunk != nullptr) {
+            w->cache.stats.hits += 1; 
+            chunk->last_used = w->cache.tick; 
+            continue; 
+        }
+        w->cache.stats.misses += 1; 
+        if(restore_chunk(w, c) == nullptr) {
+            generate.push_back(c); 
         }
     }
+    if(generate.size() > 0) {
+        gen_chunks(w, &generate); 
+    }
 }
-// void expand_grid(double *grid, int height, int width) {
 
-// }
+static void evict_chunk(World *w, Chunk *chunk) {
+    w->chunks.erase({chunk->row, chunk->col}); 
+    w->cache.stats.evictions += 1; 
+    if(chunk->dirty) {
+        w->cache.stats.persisted += 1; 
+        w->cache.queue_write(chunk); //Writer thread frees chunk. 
+    } else {
+        delete chunk; //Regenerated from seed on next load. 
+    }
+}
 
+void unload_chunk(World *w, ChunkIndices c) {
+    Chunk *chunk = w->chunks.find(c); 
+    if(chunk != nullptr) {
+        evict_chunk(w, chunk); 
+    }
+}
 
-// void gen_chunk(World *w, int chunk_row, int chunk_col) {
+void queue_tile_edit(World *w, BlockIndices b, Tile t) {
+    TileEdit e; 
+    e.chunk_row = b.chunk_row; 
+    e.chunk_col = b.chunk_col; 
+    e.index = b.row*CHUNK_TILES + b.col; 
+    e.new_tile = t; 
+    w->journal.pending.push_back(e); 
+}
 
-// }
+//Marks chunk dirty and lists it in touched, once per batch. 
+static void touch_chunk(World *w, Chunk *chunk, Chunk **last) {
+    if(chunk == *last) {
+        return; 
+    }
+    *last = chunk; 
+    chunk->dirty = true; 
+    chunk->last_used = w->cache.tick; 
+    ChunkIndices c = {chunk->row, chunk->col}; 
+    std::vector<ChunkIndices> *touched = &w->journal.touched; 
+    if(std::find(touched->begin(), touched->end(), c) == touched->end()) {
+        touched->push_back(c); 
+    }
+}
+
+int apply_tile_edits(World *w, uint32_t frame) {
+    EditJournal *j = &w->journal; 
+    j->touched.clear(); 
+    ChunkCursor cursor; 
+    Chunk *last = nullptr; 
+    int start = j->edits.size(); 
+    for (int i = 0; i < j->pending.size(); i++) {
+        TileEdit e = j->pending[i]; 
+        ChunkIndices c = {e.chunk_row, e.chunk_col}; 
+        Chunk *chunk = find_chunk(&w->chunks, c, &cursor); 
+        if(chunk == nullptr) {
+            chunk = load_chunk(w, c); 
+        }
+        Tile *t = &chunk->tiles[e.index]; 
+        if(t->tile_id == e.new_tile.tile_id && t->damage == e.new_tile.damage) {
+            continue; //No-op edits aren't journaled. 
+        }
+        e.old_tile = *t; 
+        *t = e.new_tile; 
+        j->edits.push_back(e); 
+        touch_chunk(w, chunk, &last); 
+    }
+    j->pending.clear(); 
+    int applied = j->edits.size() - start; 
+    if(applied > 0) {
+        j->frames.push_back({frame, start}); 
+    }
+
+    //Drop frames that have left the rollback window. 
+    int expired = 0; 
+    while(expired < j->frames.size() && j->frames[expired].frame + j->window <= frame) {
+        expired += 1; 
+    }
+    if(expired > 0) {
+        int cut = expired < j->frames.size() ? j->frames[expired].start : j->edits.size(); 
+        j->edits.erase(j->edits.begin(), j->edits.begin() + cut); 
+        j->frames.erase(j->frames.begin(), j->frames.begin() + expired); 
+        for (int i = 0; i < j->frames.size(); i++) {
+            j->frames[i].start -= cut; 
+        }
+    }
+    return applied; 
+}
+
+void rollback_tile_edits(World *w, uint32_t frame) {
+    EditJournal *j = &w->journal; 
+    j->touched.clear(); 
+    j->pending.clear(); 
+    ChunkCursor cursor; 
+    Chunk *last = nullptr; 
+    while(j->frames.size() > 0 && j->frames.back().frame > frame) {
+        int start = j->frames.back().start; 
+        for (int i = j->edits.size() - 1; i >= start; i--) {
+            TileEdit e = j->edits[i]; 
+            ChunkIndices c = {e.chunk_row, e.chunk_col}; 
+            Chunk *chunk = find_chunk(&w->chunks, c, &cursor); 
+            if(chunk == nullptr) {
+                chunk = load_chunk(w, c); 
+            }
+            chunk->tiles[e.index] = e.old_tile; 
+            touch_chunk(w, chunk, &last); 
+        }
+        j->edits.resize(start); 
+        j->frames.pop_back(); 
+    }
+}
+
+void pin_chunk_ring(World *w, ChunkIndices center, int radius) {
+    std::vector<ChunkIndices> ring; 
+    for (int r = -radius; r <= radius; r++) {
+        for (int c = -radius; c <= radius; c++) {
+            ring.push_back({center.row + r, center.col + c}); 
+        }
+    }
+    load_chunks(w, &ring); 
+    for (int i = 0; i < ring.size(); i++) {
+        Chunk *chunk = w->chunks.find(ring[i]); 
+        chunk->pin_tick = w->cache.tick; 
+    }
+}
+
+void pin_chunk_at(World *w, glm::dvec2 p) {
+    Chunk *chunk = w->chunks.find(pos2c(p)); 
+    if(chunk != nullptr) {
+        chunk->pin_tick = w->cache.tick; 
+        chunk->last_used = w->cache.tick; 
+    }
+}
+
+void update_chunk_cache(World *w) {
+    ChunkCache *cache = &w->cache; 
+    size_t resident = w->chunks.count * sizeof(Chunk); 
+    if(resident > cache->budget_bytes) {
+        std::vector<Chunk*> candidates; 
+        for (int i = 0; i < w->chunks.values.size(); i++) {
+            Chunk *chunk = w->chunks.values[i]; 
+            if(chunk != nullptr && chunk->pin_tick != cache->tick) {
+                candidates.push_back(chunk); 
+            }
+        }
+        int excess = (resident - cache->budget_bytes + sizeof(Chunk) - 1) / sizeof(Chunk); 
+        excess = std::min(excess, (int) candidates.size()); 
+        std::nth_element(candidates.begin(), candidates.begin() + excess, candidates.end(), 
+            [](Chunk *a, Chunk *b) { return a->last_used < b->last_used; }); 
+        for (int i = 0; i < excess; i++) {
+            evict_chunk(w, candidates[i]); 
+        }
+    }
+    cache->tick += 1; 
+}
 
 Tile query_tile(World *w, BlockIndices b) {
-    ChunkIndices c = b2c(b); 
-    if(w->chunks.count(c) > 0) {
-        Chunk* chunk = w->chunks.at(c); 
+    Chunk* chunk = w->chunks.find(b2c(b)); 
+    if(chunk != nullptr) {
+        chunk->last_used = w->cache.tick; 
         return chunk->tiles[b.row*CHUNK_TILES + b.col]; 
     }
     return {-1}; //Null ID
 }
-Chunk* query_chunk(World *w, ChunkIndices c) {
-    if(w->chunks.count(c) > 0) {
-        return w->chunks.at(c); 
+
+Tile query_tile(World *w, BlockIndices b, ChunkCursor *cursor) {
+    Chunk* chunk = find_chunk(&w->chunks, b2c(b), cursor); 
+    if(chunk != nullptr) {
+        chunk->last_used = w->cache.tick; 
+        return chunk->tiles[b.row*CHUNK_TILES + b.col]; 
     }
-    return nullptr; 
+    return {-1}; //Null ID
+}
+
+Chunk* query_chunk(World *w, ChunkIndices c) {
+    return w->chunks.find(c); 
 }
 
 bool set_tile(World *w, BlockIndices b, Tile t) {
-    ChunkIndices c = b2c(b); 
-    if(w->chunks.count(c) > 0) {
-        Chunk* chunk = w->chunks.at(c); 
+    Chunk* chunk = w->chunks.find(b2c(b)); 
+    if(chunk != nullptr) {
         chunk->tiles[b.row*CHUNK_TILES + b.col] = t; 
+        chunk->last_used = w->cache.tick; 
+        chunk->dirty = true; 
         return true;
     }
     return false; 
 }
 
+bool set_tile(World *w, BlockIndices b, Tile t, ChunkCursor *cursor) {
+    Chunk* chunk = find_chunk(&w->chunks, b2c(b), cursor); 
+    if(chunk != nullptr) {
+        chunk->tiles[b.row*CHUNK_TILES + b.col] = t; 
+        chunk->last_used = w->cache.tick; 
+        chunk->dirty = true; 
+        return true; 
+    }
+    return false; 
+}
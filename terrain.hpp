@@ -1,28 +1,111 @@
+#ifndef HEADERFILE_TERRAIN
+#define HEADERFILE_TERRAIN
+
 #include <glm/glm.hpp>
 #include <vector>
 #include "chunk.hpp"
+#include "chunk_cache.hpp"
 
+const char TILE_AIR = 0; 
+const char TILE_DIRT = 1; 
+const char TILE_ORE = 2; 
 
-void add_grid(double* g1, double* g2, double alpha, double beta, double* gout, int height, int width); 
-void mul_grid(double alpha, double *grid, int height); 
-void perlin_noise(double* grid, int height, int width);
-
-struct World {
-	std::unordered_map<ChunkIndices, Chunk*> chunks;
-	std::vector<int> world_operations;  
+//Tunables for the generation pipeline. Scales are in tiles per lattice cell.
+struct TerrainParams {
+	int octaves = 4; 
+	float cell_width = 24; 
+	float lacunarity = 2.0f; //Frequency multiplier per octave.
+	float gain = 0.5f; //Amplitude multiplier per octave.
+	int warp_octaves = 2; 
+	float warp_scale = 48; 
+	float warp_strength = 12; //Maximum domain offset in tiles.
+	float cave_threshold = 0.12f; //Density above threshold is carved out.
+	int surface_octaves = 3; 
+	float surface_scale = 64; 
+	float surface_height = 0; //World row of the mean surface.
+	float surface_amplitude = 24; 
+	float ore_scale = 6; 
+	float ore_threshold = 0.3f; 
 }; 
 
-void gen_chunk(World *w, int chunk_row, int chunk_col); 
-void load_chunk(World *w, ChunkIndices c); 
-void unload_chunk(World *w, ChunkIndices c); 
-Tile query_tile(World *w, BlockIndices b); //May fail and return empty tile
-Chunk* query_chunk(World *w, int chunk_row, int chunk_col); //May fail and return null
-bool set_tile(World *w, BlockIndices b, Tile t); 
+//Gradient noise at a point in lattice units. Pure function of (seed, x, y).
+float gradient_noise(uint32_t seed, float x, float y); 
+//Adds amp * noise(x[i]*freq, y[i]*freq) to out[i]. Branch free so the loop vectorizes.
+void noise_strip(const float* x, const float* y, float* out, int n, float freq, float amp, uint32_t seed); 
+//Adds normalized multi-octave noise to out. n must be at most CHUNK_TILES.
+void fractal_noise_strip(const float* x, const float* y, float* out, int n, int octaves, float freq, 
+							float lacunarity, float gain, uint32_t seed); 
 
+void add_grid(float* g1, float* g2, float alpha, float beta, float* gout, int height, int width); 
+void mul_grid(float alpha, float *grid, int height, int width); 
+//Adds noise sampled at world tiles [row0, row0+height) x [col0, col0+width) to grid.
+void perlin_noise(float* grid, int height, int width, int row0, int col0, float cell_width, uint32_t seed); 
 
-/*
+//One applied tile change. Enough to redo or undo it without touching the rest of the chunk. 
+struct TileEdit {
+	int32_t chunk_row, chunk_col; 
+	uint16_t index; //row*CHUNK_TILES + col inside the chunk. 
+	Tile old_tile; 
+	Tile new_tile; 
+}; 
+
+struct JournalFrame {
+	uint32_t frame; 
+	int start; //Index of the frame's first entry in EditJournal::edits. 
+}; 
 
+/*
+Tile edits for the last `window` frames. Edits are queued during a tick and applied together 
+by apply_tile_edits, so each touched chunk is invalidated once per frame. Rolling back replays 
+the journal in reverse, instead of saving whole chunks every tick. 
 */
+struct EditJournal {
+	std::vector<TileEdit> pending; 
+	std::vector<TileEdit> edits; //Oldest first. 
+	std::vector<JournalFrame> frames; //Frames with at least one edit, oldest first. 
+	std::vector<ChunkIndices> touched; //Chunks changed by the last apply or rollback, each listed once. 
+	int window = 16; 
+}; 
 
+struct World {
+	uint32_t seed = 0; 
+	TerrainParams terrain; 
+	ChunkMap chunks = ChunkMap(64); 
+	ChunkCache cache; 
+	EditJournal journal; 
+}; 
 
+//Fills chunk->tiles from chunk->row, chunk->col and seed. Touches no shared state, safe to call from any thread.
+//Runs warp, fractal density, surface, caves and ore in a single pass over the chunk rows.
+void gen_chunk_tiles(Chunk *chunk, uint32_t seed, const TerrainParams *tp); 
+void gen_chunk(World *w, int chunk_row, int chunk_col); 
+//Generates every chunk in the list not already in w, split across all cores. Ignores saved chunks.
+void gen_chunks(World *w, std::vector<ChunkIndices> *chunk_list); 
+//Returns chunk c, taking it from the write queue, disk or generator when not resident. 
+Chunk* load_chunk(World *w, ChunkIndices c); 
+//Loads every missing chunk in the list. Chunks with no saved copy are generated in parallel. 
+void load_chunks(World *w, std::vector<ChunkIndices> *chunk_list); 
+void unload_chunk(World *w, ChunkIndices c); //Dirty chunks are persisted in the background. 
+
+//Queues b to be set to t at the next apply_tile_edits. 
+void queue_tile_edit(World *w, BlockIndices b, Tile t); 
+//Applies queued edits as journal frame `frame` and fills journal.touched. Returns edits applied. 
+int apply_tile_edits(World *w, uint32_t frame); 
+//Undoes, newest first, every edit from frames after `frame`. Pair with restoring the ECS to the same frame. 
+void rollback_tile_edits(World *w, uint32_t frame); 
+
+//Loads and pins the (2*radius+1)^2 chunks around center, e.g. a player's active ring. 
+void pin_chunk_ring(World *w, ChunkIndices center, int radius); 
+//Pins the chunk holding p if resident, e.g. for chunks with live entities. 
+void pin_chunk_at(World *w, glm::dvec2 p); 
+//Evicts least recently used unpinned chunks until under budget, then starts the next cache tick. 
+//Call once per tick after pinning. 
+void update_chunk_cache(World *w); 
+Tile query_tile(World *w, BlockIndices b); //May fail and return empty tile
+//Cursor variants remember the last chunk hit. Use one cursor per caller or loop. 
+Tile query_tile(World *w, BlockIndices b, ChunkCursor *cursor); 
+Chunk* query_chunk(World *w, ChunkIndices c); //May fail and return null
+bool set_tile(World *w, BlockIndices b, Tile t); 
+bool set_tile(World *w, BlockIndices b, Tile t, ChunkCursor *cursor); 
 
+#endif
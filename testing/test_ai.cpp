@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include "../ai.hpp"
+#include "../particle.hpp"
+
+static bool scheduled(Gamestate *g, int eid) {
+	std::vector<int> *indices = &g->ai_schedule.indices; 
+	return std::find(indices->begin(), indices->end(), g->ecs->ai_map[eid]) != indices->end(); 
+}
+
+static void place(RollbackECS *ecs, int eid, glm::dvec2 p) {
+	Entity *e = &ecs->entities[ecs->entity_map[eid]]; 
+	e->pos = p; 
+	e->dim = glm::dvec2(1, 1); 
+	e->vel = glm::dvec2(0, 0); 
+}
+
+int main( int argc, char* args[] ) {
+	int errors = 0; 
+	SpriteSheet sheet; 
+	ParticleSystem particles(16); 
+	Gamestate g = Gamestate(&sheet, &particles); 
+	RollbackECS *ecs = g.ecs; 
+	int player = ecs->push_player(); 
+	place(ecs, player, glm::dvec2(0, 0)); 
+	int near = ecs->push_firefly(glm::dvec2(0, 0)); 
+	place(ecs, near, glm::dvec2(AI_NEAR_DISTANCE / 2, 0)); 
+	std::vector<int> mid; 
+	for (int i = 0; i < 2*AI_MID_PERIOD; i++) {
+		mid.push_back(ecs->push_firefly(glm::dvec2(0, 0))); 
+		place(ecs, mid.back(), glm::dvec2((AI_NEAR_DISTANCE + AI_FAR_DISTANCE) / 2, i)); 
+	}
+	int far = ecs->push_firefly(glm::dvec2(0, 0)); 
+	place(ecs, far, glm::dvec2(2 * AI_FAR_DISTANCE, 0)); 
+	int fireflies = 2 + mid.size(); 
+
+	//Entries pushed since the last save update run on their first tick, whatever their distance.
+	g.frame = 10; 
+	schedule_ai(&g); 
+	if(g.ai_schedule.indices.size() != fireflies || !scheduled(&g, far)) {
+		printf("%d of %d new entries scheduled\n", (int) g.ai_schedule.indices.size(), fireflies); 
+		errors += 1; 
+	}
+	ecs->roll_save(); 
+
+	//Near entries update every tick, mid range ones every AI_MID_PERIOD ticks phased by id, far ones never.
+	int mid_updates = 0; 
+	for (int t = 0; t < 4*AI_MID_PERIOD; t++) {
+		g.frame += 1; 
+		schedule_ai(&g); 
+		AISchedule *s = &g.ai_schedule; 
+		if(!scheduled(&g, near) || scheduled(&g, far)) {
+			printf("Frame %d: near or far entry scheduled wrong\n", g.frame); 
+			errors += 1; 
+		}
+		int mid_now = 0; 
+		for (int i = 0; i < mid.size(); i++) {
+			bool due = (g.frame + mid[i]) % AI_MID_PERIOD == 0; 
+			errors += scheduled(&g, mid[i]) != due; 
+			mid_now += due; 
+		}
+		mid_updates += mid_now; 
+		if(mid_now != mid.size() / AI_MID_PERIOD) {
+			printf("Frame %d: %d mid range entries updated, expected an even share\n", g.frame, mid_now); 
+			errors += 1; 
+		}
+		if(s->lod_count[AI_LOD_NEAR] != 1 || s->lod_count[AI_LOD_MID] != mid.size() || s->lod_count[AI_LOD_DORMANT] != 1) {
+			printf("Frame %d: level of detail counts %d %d %d\n", g.frame,
+					s->lod_count[AI_LOD_NEAR], s->lod_count[AI_LOD_MID], s->lod_count[AI_LOD_DORMANT]); 
+			errors += 1; 
+		}
+	}
+	if(mid_updates != 4 * mid.size()) {
+		printf("Mid range entries updated %d times over 4 periods\n", mid_updates); 
+		errors += 1; 
+	}
+
+	//Every firefly is hittable every tick, even when it isn't scheduled.
+	for (int t = 0; t < AI_MID_PERIOD; t++) {
+		g.frame += 1; 
+		g.hitboxes.clear(); 
+		run_ai(&g); 
+		if(g.hitboxes.count != fireflies) {
+			printf("Frame %d: %d hitboxes for %d fireflies\n", g.frame, g.hitboxes.count, fireflies); 
+			errors += 1; 
+		}
+	}
+
+	//Schedules are grouped by type, both before and after a save update sorts ai_data. 
+	for (int i = 0; i < 3; i++) {
+		int fb = ecs->push_fireball(glm::dvec2(0, 0), glm::dvec2(0, 0)); 
+		place(ecs, fb, glm::dvec2(1, i)); 
+		ecs->push_firefly(glm::dvec2(0, 0)); 
+	}
+	for (int pass = 0; pass < 2; pass++) {
+		g.frame += 1; 
+		schedule_ai(&g); 
+		AISchedule *s = &g.ai_schedule; 
+		for (int t = 0; t < AI_TYPE_COUNT; t++) {
+			for (int k = s->type_start[t]; k < s->type_start[t+1]; k++) {
+				if(ai_type_slot(ecs->ai_data[s->indices[k]].type) != t) {
+					printf("Entry of type %d scheduled with type %d\n", ecs->ai_data[s->indices[k]].type, t); 
+					errors += 1; 
+				}
+			}
+		}
+		if(s->type_start[FIREBALL+1] - s->type_start[FIREBALL] != 3) {
+			printf("%d fireballs scheduled, expected 3\n", s->type_start[FIREBALL+1] - s->type_start[FIREBALL]); 
+			errors += 1; 
+		}
+		ecs->roll_save(); 
+	}
+	for (int t = 0; t < AI_TYPE_COUNT; t++) {
+		for (int i = ecs->ai_type_start[t]; i < ecs->ai_type_start[t+1]; i++) {
+			errors += ai_type_slot(ecs->ai_data[i].type) != t; 
+		}
+	}
+	errors += ecs->ai_type_start[AI_TYPE_COUNT] != ecs->ai_data.size(); 
+
+	printf("%d errors\n", errors); 
+	return errors == 0 ? 0 : 1; 
+}
@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../atlas.hpp"
+
+int save(const char *path, std::vector<char> *bytes) {
+	FILE *f = fopen(path, "wb"); 
+	if(f == NULL) return 1; 
+	fwrite(bytes->data(), 1, bytes->size(), f); 
+	fclose(f); 
+	return 0; 
+}
+
+int main( int argc, char* args[] ) {
+	int errors = 0; 
+	std::vector<std::string> pages = {"resources/sprites.png", "resources/tile_sheet.png"}; 
+	std::vector<ManifestSprite> sprites; 
+	const char *names[] = {"player_dot", "jump_cloud", "jump_flash", "fireball", "a", "zz_last"}; 
+	for (int i = 0; i < 6; i++) {
+		sprites.push_back(ManifestSprite {names[i], 0, (uint16_t) (i + 1), 10*i, 20*i, 8*(i + 1), 8}); 
+	}
+	std::vector<AtlasTile> tiles = {{1, 0, 0, 0, 128, 128}, {1, 0, 128, 0, 128, 128}}; 
+	std::vector<char> bytes; 
+	write_manifest(&bytes, &pages, sprites, &tiles); 
+	if(bytes.size() % 4 != 0) {
+		printf("Manifest of %d bytes isn't 4 byte aligned\n", (int) bytes.size()); 
+		errors += 1; 
+	}
+
+	//Mapped from disk, every sprite is found with its fields, and missing names aren't.
+	const char *path = "test_atlas_manifest.bin"; 
+	errors += save(path, &bytes); 
+	AtlasManifest m; 
+	if(!map_manifest(&m, path)) {
+		printf("Couldn't map manifest\n"); 
+		return 1; 
+	}
+	for (int i = 0; i < 6; i++) {
+		const AtlasSprite *s = find_manifest_sprite(&m, names[i]); 
+		if(s == NULL || strcmp(manifest_string(&m, s->name), names[i]) != 0 || s->frames != i + 1 || s->x != 10*i || s->w != 8*(i + 1)) {
+			printf("Sprite %s wasn't found intact\n", names[i]); 
+			errors += 1; 
+		}
+	}
+	if(find_manifest_sprite(&m, "missing") != NULL || find_manifest_sprite(&m, "") != NULL) {
+		printf("Found a sprite that doesn't exist\n"); 
+		errors += 1; 
+	}
+	if(m.header->tile_count != 2 || m.tiles[1].x != 128 || strcmp(manifest_string(&m, m.pages[1].path), "resources/tile_sheet.png") != 0) {
+		printf("Tiles or pages weren't read back\n"); 
+		errors += 1; 
+	}
+	for (int i = 0; i + 1 < m.header->sprite_count; i++) {
+		if(strcmp(manifest_string(&m, m.sprites[i].name), manifest_string(&m, m.sprites[i+1].name)) >= 0) {
+			printf("Sprites aren't sorted\n"); 
+			errors += 1; 
+		}
+	}
+	close_manifest(&m); 
+
+	//Truncated, wrong version or out of range manifests are rejected.
+	std::vector<char> bad(bytes.begin(), bytes.end() - 4); 
+	if(view_manifest(&m, bad.data(), bad.size())) errors += 1; 
+	bad = bytes; 
+	((AtlasHeader*) bad.data())->version += 1; 
+	if(view_manifest(&m, bad.data(), bad.size())) errors += 1; 
+	bad = bytes; 
+	AtlasSprite *first = (AtlasSprite*) (bad.data() + sizeof(AtlasHeader) + pages.size()*sizeof(AtlasPage)); 
+	first->page = 7; 
+	if(view_manifest(&m, bad.data(), bad.size())) errors += 1; 
+	remove(path); 
+	printf("%d errors\n", errors); 
+	return errors == 0 ? 0 : 1; 
+}
@@ -0,0 +1,47 @@
+#include <stdio.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../terrain.hpp"
+
+//Walks a player across the world with a small budget, editing one tile per chunk, 
+//then walks back and checks every edit survived eviction. 
+int main( int argc, char* args[] ) {
+	World w; w.seed = 11; 
+	w.cache.budget_bytes = 40 * sizeof(Chunk); 
+	w.cache.save_dir = "test_saves"; 
+
+	int errors = 0; 
+	int max_resident = 0; 
+	const int STEPS = 120; 
+	for (int pass = 0; pass < 2; pass++) {
+		for (int i = 0; i < STEPS; i++) {
+			int col = pass == 0 ? i : STEPS - 1 - i; 
+			ChunkIndices center = {0, col}; 
+			pin_chunk_ring(&w, center, 2); //25 pinned chunks. 
+			pin_chunk_at(&w, glm::dvec2((col - 10) * CHUNK_WIDTH, 0)); //Entity far behind the player. 
+
+			BlockIndices b = {5, 7, center.row, center.col}; 
+			if(pass == 0) {
+				set_tile(&w, b, Tile {TILE_ORE, (char) (col % 100)}); 
+			} else {
+				Tile t = query_tile(&w, b); 
+				if(t.tile_id != TILE_ORE || t.damage != col % 100) {
+					printf("Lost edit in chunk %d\n", col); 
+					errors += 1; 
+				}
+			}
+			update_chunk_cache(&w); 
+			if(w.chunks.count > max_resident) {
+				max_resident = w.chunks.count; 
+			}
+		}
+	}
+	w.cache.flush(); 
+
+	ChunkCacheStats s = w.cache.stats; 
+	printf("Max resident %d chunks (budget %d)\n", max_resident, (int) (w.cache.budget_bytes / sizeof(Chunk))); 
+	printf("Hits %llu, misses %llu, hit rate %.3f\n", s.hits, s.misses, chunk_cache_hit_rate(s)); 
+	printf("Evictions %llu, persisted %llu, rescued %llu, loaded %llu\n", s.evictions, s.persisted, s.rescued, s.loaded); 
+	printf("%d errors\n", errors); 
+	return errors == 0 && max_resident <= 40 ? 0 : 1; 
+}
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include <SDL.h>
+#include "../chunk.hpp"
+#include "../terrain.hpp"
+
+//Random inserts and erases checked against std::unordered_map. 
+int check_map() {
+	ChunkMap m = ChunkMap(16); 
+	std::unordered_map<ChunkIndices, Chunk*> ref; 
+	std::vector<Chunk> storage(4096); 
+	int errors = 0; 
+	srand(7); 
+	for (int i = 0; i < 200000; i++) {
+		ChunkIndices c = {rand() % 64 - 32, rand() % 64 - 32}; 
+		int op = rand() % 3; 
+		if(op == 0) {
+			Chunk *chunk = &storage[rand() % storage.size()]; 
+			m.insert(c, chunk); 
+			ref[c] = chunk; 
+		} else if(op == 1) {
+			Chunk *removed = m.erase(c); 
+			Chunk *expected = ref.count(c) > 0 ? ref.at(c) : nullptr; 
+			ref.erase(c); 
+			errors += removed != expected; 
+		} else {
+			Chunk *expected = ref.count(c) > 0 ? ref.at(c) : nullptr; 
+			errors += m.find(c) != expected; 
+		}
+	}
+	errors += m.count != ref.size(); 
+	//A cursor cached on a key must not outlive a replacement of its chunk. 
+	ChunkCursor cursor; 
+	ChunkIndices c = {100, 100}; 
+	m.insert(c, &storage[0]); 
+	errors += find_chunk(&m, c, &cursor) != &storage[0]; 
+	m.insert(c, &storage[1]); 
+	if(find_chunk(&m, c, &cursor) != &storage[1]) {
+		printf("Cursor returned a replaced chunk\n"); 
+		errors += 1; 
+	}
+	printf("ChunkMap: %d entries, %d errors\n", m.count, errors); 
+	return errors; 
+}
+
+//Tile reads in scanline order over a 3x3 chunk neighborhood, the pattern physics and rendering use. 
+void bench_queries() {
+	World w; w.seed = 5; 
+	std::unordered_map<ChunkIndices, Chunk*> ref; 
+	for (int r = -1; r <= 1; r++) {
+		for (int c = -1; c <= 1; c++) {
+			gen_chunk(&w, r, c); 
+			ref[{r, c}] = query_chunk(&w, {r, c}); 
+		}
+	}
+	const int PASSES = 200; 
+	long solid[3] = {0, 0, 0}; 
+	uint32_t ticks[3]; 
+	for (int mode = 0; mode < 3; mode++) {
+		ChunkCursor cursor; 
+		uint32_t start = SDL_GetTicks(); 
+		for (int p = 0; p < PASSES; p++) {
+			for (int y = -CHUNK_TILES; y < 2*CHUNK_TILES; y++) {
+				for (int x = -CHUNK_TILES; x < 2*CHUNK_TILES; x++) {
+					int cr = (y + 4*CHUNK_TILES) / CHUNK_TILES - 4; 
+					int cc = (x + 4*CHUNK_TILES) / CHUNK_TILES - 4; 
+					BlockIndices b = {y - cr*CHUNK_TILES, x - cc*CHUNK_TILES, cr, cc}; 
+					Tile t; 
+					if(mode == 0) {
+						ChunkIndices c = b2c(b); 
+						t = ref.count(c) > 0 ? ref.at(c)->tiles[b.row*CHUNK_TILES + b.col] : Tile {-1}; 
+					} else if(mode == 1) {
+						t = query_tile(&w, b); 
+					} else {
+						t = query_tile(&w, b, &cursor); 
+					}
+					solid[mode] += t.tile_id > 0; 
+				}
+			}
+		}
+		ticks[mode] = SDL_GetTicks() - start; 
+	}
+	int lookups = PASSES * 9 * CHUNK_TILES * CHUNK_TILES; 
+	printf("%d lookups: unordered_map %d ms, ChunkMap %d ms, ChunkMap+cursor %d ms\n", 
+			lookups, ticks[0], ticks[1], ticks[2]); 
+	printf("Solid counts %ld %ld %ld\n", solid[0], solid[1], solid[2]); 
+}
+
+int main( int argc, char* args[] ) {
+	int errors = check_map(); 
+	bench_queries(); 
+	return errors == 0 ? 0 : 1; 
+}
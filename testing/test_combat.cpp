@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include <SDL.h>
+#include "../combat.hpp"
+
+//Boxes scattered with constant density, so the number of real overlaps grows linearly. 
+void populate(HurtboxBuffer *hurt, HitboxBuffer *hit, int num_hurt, int num_hit) {
+	double side = 4 * sqrt((double) (num_hurt + num_hit)); 
+	hurt->clear(); hit->clear(); 
+	for (int i = 0; i < num_hurt; i++) {
+		glm::dvec2 p = glm::dvec2(side * rand() / RAND_MAX, side * rand() / RAND_MAX); 
+		hurt->push({parent_id: i, pos: p, dim: glm::dvec2(1, 1), vel: glm::dvec2(0, 0), weight: 1, power: 1}); 
+	}
+	for (int i = 0; i < num_hit; i++) {
+		glm::dvec2 p = glm::dvec2(side * rand() / RAND_MAX, side * rand() / RAND_MAX); 
+		hit->push({id: i, parent_id: num_hurt + i, pos: p, dim: glm::dvec2(1, 2), hitflags: 0}); 
+	}
+}
+
+//A held attack overlapping two targets hits each once, then again after its lifetime. 
+int check_registry() {
+	HurtboxBuffer hurt; 
+	HitboxBuffer hit; 
+	std::vector<HitPair> hits; 
+	CombatGrid grid; 
+	HitRegistry registry; 
+	hurt.push({parent_id: 0, pos: glm::dvec2(0, 0), dim: glm::dvec2(4, 4), vel: glm::dvec2(0, 0), 
+					weight: 1, power: 1, attack_id: 7, lifetime: 10}); 
+	hit.push({id: 0, parent_id: 1, pos: glm::dvec2(1, 1), dim: glm::dvec2(1, 1)}); 
+	hit.push({id: 1, parent_id: 2, pos: glm::dvec2(2, 2), dim: glm::dvec2(1, 1)}); 
+	int per_frame[25]; 
+	int total = 0; 
+	for (uint32_t f = 0; f < 25; f++) {
+		registry.expire(f); 
+		hits.clear(); 
+		addHits(&hurt, &hit, &hits, &grid, &registry, f); 
+		per_frame[f] = hits.size(); 
+		total += hits.size(); 
+	}
+	bool ok = per_frame[0] == 2 && per_frame[1] == 0 && per_frame[10] == 2 && per_frame[20] == 2 && total == 6; 
+
+	//Expiring before any entry is due leaves the table alone. 
+	HitRegistry r; 
+	r.record(1, 1, 0, 10); 
+	r.record(2, 1, 3, 10); 
+	const uint64_t *table = r.keys.data(); 
+	r.expire(9); 
+	ok = ok && r.keys.data() == table && r.count == 2; 
+	r.expire(10); 
+	ok = ok && r.count == 1 && r.next_expiry == 13; 
+	//Zero lifetimes hit every time and take no slot. 
+	ok = ok && r.record(3, 1, 0, 0) && r.record(3, 1, 0, 0) && r.count == 1; 
+	printf("Registry: %d hits over 25 frames, %d live entries\n", total, registry.count); 
+	return ok ? 0 : 1; 
+}
+
+//Shaped boxes only hit when the shapes overlap, not just their bounds. 
+int check_shapes() {
+	HurtboxBuffer hurt; 
+	HitboxBuffer hit; 
+	std::vector<HitPair> hits, brute_hits; 
+	CombatGrid grid; 
+	HitRegistry registry; 
+	Hurtbox a = {parent_id: 0, pos: glm::dvec2(0, 0), dim: glm::dvec2(0, 0), vel: glm::dvec2(0, 0), weight: 1, power: 1}; 
+	//Capsule swept diagonally across the origin cell, radius 0.25. 
+	hurt.push(a, capsuleShape(glm::dvec2(0, 0), glm::dvec2(8, 8), 0.25)); 
+	//Diamond centered at (4, 4), on the sweep. 
+	glm::dvec2 diamond[] = {glm::dvec2(0, -1), glm::dvec2(1, 0), glm::dvec2(0, 1), glm::dvec2(-1, 0)}; 
+	hit.push({id: 0, parent_id: 1, pos: glm::dvec2(0, 0), dim: glm::dvec2(0, 0)}, polygonShape(glm::dvec2(4, 4), diamond, 4)); 
+	//Plain box in the capsule's bounds but off the sweep. 
+	hit.push({id: 1, parent_id: 2, pos: glm::dvec2(6, 0.5), dim: glm::dvec2(1, 1)}); 
+	//Box rotated 45 degrees, edge 0.1 from the capsule's surface. 
+	double off = 1 + 0.25 + 0.1; 
+	hit.push({id: 2, parent_id: 3, pos: glm::dvec2(0, 0), dim: glm::dvec2(0, 0)}, 
+				orientedBoxShape(glm::dvec2(2 + off / sqrt(2.0), 2 - off / sqrt(2.0)), glm::dvec2(1, 1), atan(1.0))); 
+	//Circle touching the capsule's end cap. 
+	hit.push({id: 3, parent_id: 4, pos: glm::dvec2(0, 0), dim: glm::dvec2(0, 0)}, 
+				capsuleShape(glm::dvec2(8.5, 8.5), glm::dvec2(8.5, 8.5), 0.5)); 
+	addHits(&hurt, &hit, &hits, &grid, &registry, 1); 
+	addHitsBruteForce(&hurt, &hit, &brute_hits); 
+	bool ok = hits.size() == 2 && hits[0].hitbox == 0 && hits[1].hitbox == 3 && brute_hits.size() == 2; 
+	//Polygons with too many vertices fall back to a box covering all of them, not a truncated outline. 
+	glm::dvec2 ring[12]; 
+	for (int i = 0; i < 12; i++) ring[i] = glm::dvec2(cos(i * M_PI / 6), sin(i * M_PI / 6)); 
+	CombatShape big = polygonShape(glm::dvec2(10, 10), ring, 12); 
+	ok = ok && big.num_vertices == 4 && big.vertices[0] == glm::dvec2(9, 9) && big.vertices[2] == glm::dvec2(11, 11); 
+	printf("Shapes: %d of 4 hit\n", (int) hits.size()); 
+	return ok ? 0 : 1; 
+}
+
+//Merged deltas are the same whatever order the deltas arrive in. 
+int check_merge() {
+	std::vector<CombatDelta> deltas, shuffled; 
+	for (int i = 0; i < 200; i++) {
+		double v = (double) rand() / RAND_MAX; 
+		deltas.push_back(CombatDelta {rand() % 17, i, glm::dvec2(v, -v * 1e-3), v * 1e7, (uint32_t) (1 << (i % 3))}); 
+	}
+	shuffled = deltas; 
+	for (int i = shuffled.size() - 1; i > 0; i--) {
+		std::swap(shuffled[i], shuffled[rand() % (i + 1)]); 
+	}
+	mergeCombatDeltas(&deltas); 
+	mergeCombatDeltas(&shuffled); 
+	int errors = deltas.size() == shuffled.size() ? 0 : 1; 
+	for (int i = 0; errors == 0 && i < deltas.size(); i++) {
+		CombatDelta a = deltas[i]; CombatDelta b = shuffled[i]; 
+		if(a.entity_id != b.entity_id || a.delta_v != b.delta_v || a.damage != b.damage || a.flags != b.flags 
+			|| (i > 0 && deltas[i-1].entity_id >= a.entity_id)) {
+			errors += 1; 
+		}
+	}
+	printf("Merge: %d entities\n", (int) deltas.size()); 
+	return errors; 
+}
+
+int main( int argc, char* args[] ) {
+	HurtboxBuffer hurt; 
+	HitboxBuffer hit; 
+	std::vector<HitPair> brute_hits, grid_hits; 
+	CombatGrid grid; 
+	HitRegistry registry; 
+	int errors = 0; 
+	srand(2); 
+	const int REPEATS = 50; 
+	for (int scale = 1; scale <= 16; scale *= 2) {
+		int num_hurt = 125 * scale; int num_hit = 75 * scale; 
+		populate(&hurt, &hit, num_hurt, num_hit); 
+
+		uint64_t start = SDL_GetPerformanceCounter(); 
+		for (int r = 0; r < REPEATS; r++) {
+			brute_hits.clear(); 
+			addHitsBruteForce(&hurt, &hit, &brute_hits); 
+		}
+		uint64_t brute = SDL_GetPerformanceCounter() - start; 
+
+		start = SDL_GetPerformanceCounter(); 
+		for (int r = 0; r < REPEATS; r++) {
+			grid_hits.clear(); 
+			addHits(&hurt, &hit, &grid_hits, &grid, &registry, 0); 
+		}
+		uint64_t grid_t = SDL_GetPerformanceCounter() - start; 
+
+		if(brute_hits.size() != grid_hits.size()) {
+			errors += 1; 
+		} else {
+			for (int i = 0; i < brute_hits.size(); i++) {
+				if(brute_hits[i].hurtbox != grid_hits[i].hurtbox || brute_hits[i].hitbox != grid_hits[i].hitbox) {
+					errors += 1; 
+					break; 
+				}
+			}
+		}
+		double freq = SDL_GetPerformanceFrequency() / 1e6; 
+		printf("%5d hurt x %5d hit: %5d hits, brute force %8.1f us, grid %7.1f us\n", num_hurt, num_hit, 
+				(int) grid_hits.size(), brute / freq / REPEATS, grid_t / freq / REPEATS); 
+	}
+	errors += check_registry(); 
+	errors += check_shapes(); 
+	errors += check_merge(); 
+	printf("%d errors\n", errors); 
+	return errors == 0 ? 0 : 1; 
+}
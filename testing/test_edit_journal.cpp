@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../terrain.hpp"
+
+//Applies random edits for 40 frames, then rolls back to each frame still inside the window 
+//and compares against a snapshot taken at that frame. 
+int main( int argc, char* args[] ) {
+	const int FRAMES = 40; 
+	World w; w.seed = 3; 
+	w.journal.window = 16; 
+	std::vector<ChunkIndices> cs = {{0, 0}, {0, 1}}; 
+	gen_chunks(&w, &cs); 
+
+	std::vector<std::vector<Tile>> snapshots; 
+	int errors = 0; 
+	srand(1); 
+	for (uint32_t f = 0; f < FRAMES; f++) {
+		int num_edits = rand() % 4; //Some frames have no edits. 
+		for (int i = 0; i < num_edits; i++) {
+			BlockIndices b = {rand() % CHUNK_TILES, rand() % CHUNK_TILES, 0, rand() % 2}; 
+			queue_tile_edit(&w, b, Tile {(char) (rand() % 3), 0}); 
+		}
+		apply_tile_edits(&w, f); 
+		std::vector<Tile> snap; 
+		for (int c = 0; c < 2; c++) {
+			Chunk *chunk = query_chunk(&w, cs[c]); 
+			snap.insert(snap.end(), chunk->tiles, chunk->tiles + CHUNK_TILES*CHUNK_TILES); 
+		}
+		snapshots.push_back(snap); 
+	}
+	printf("Journal holds %d edits over %d frames\n", (int) w.journal.edits.size(), (int) w.journal.frames.size()); 
+
+	for (int f = FRAMES - 1; f >= FRAMES - w.journal.window; f--) {
+		rollback_tile_edits(&w, f); 
+		std::vector<Tile> snap; 
+		for (int c = 0; c < 2; c++) {
+			Chunk *chunk = query_chunk(&w, cs[c]); 
+			snap.insert(snap.end(), chunk->tiles, chunk->tiles + CHUNK_TILES*CHUNK_TILES); 
+		}
+		if(memcmp(snap.data(), snapshots[f].data(), snap.size()*sizeof(Tile)) != 0) {
+			printf("Rollback to frame %d does not match snapshot\n", f); 
+			errors += 1; 
+		}
+	}
+	printf("%d errors\n", errors); 
+	return errors == 0 ? 0 : 1; 
+}
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include <SDL.h>
+#include "../flowfield.hpp"
+
+//Repaired field must match one built from scratch on the same terrain.
+int compare(FlowField *a, FlowField *b) {
+	int errors = 0; 
+	for (int i = 0; i < FLOW_SIDE*FLOW_SIDE; i++) {
+		if(a->dist[i] != b->dist[i]) errors += 1; 
+	}
+	return errors; 
+}
+
+//Following the field from every reachable tile ends on the target in exactly dist steps.
+int follow(FlowField *f) {
+	int errors = 0; 
+	for (int i = 0; i < FLOW_SIDE*FLOW_SIDE; i += 7) {
+		if(f->dist[i] == FLOW_UNREACHED || f->dist[i] == 0) continue; 
+		glm::dvec2 p = glm::dvec2(f->origin.col + i % FLOW_SIDE + 0.5, f->origin.row + i / FLOW_SIDE + 0.5); 
+		glm::dvec2 d; 
+		int steps = 0; 
+		while (sample_flow(f, p, &d) && steps <= f->dist[i]) {
+			p += d; 
+			steps += 1; 
+		}
+		if(steps != f->dist[i] || (int) floor(p.y) != f->target_tile.row || (int) floor(p.x) != f->target_tile.col) {
+			errors += 1; 
+		}
+	}
+	return errors; 
+}
+
+int main( int argc, char* args[] ) {
+	World w; w.seed = 7; 
+	std::vector<ChunkIndices> cs; 
+	for (int r = -FLOW_RADIUS; r <= FLOW_RADIUS; r++) {
+		for (int c = -FLOW_RADIUS; c <= FLOW_RADIUS; c++) {
+			cs.push_back({1 + r, c}); 
+		}
+	}
+	gen_chunks(&w, &cs); 
+	//Target in an open tile of chunk (1, 0).
+	Chunk *center = query_chunk(&w, {1, 0}); 
+	int t = 0; 
+	while (center->tiles[t].tile_id != TILE_AIR) t++; 
+	FlowTarget target = {0, glm::dvec2(t % CHUNK_TILES + 0.5, CHUNK_TILES + t / CHUNK_TILES + 0.5)}; 
+
+	FlowFields ff, fresh; 
+	uint64_t start = SDL_GetPerformanceCounter(); 
+	update_flow_fields(&ff, &w, &target, 1, 0); 
+	double freq = SDL_GetPerformanceFrequency() / 1e6; 
+	double build_us = (SDL_GetPerformanceCounter() - start) / freq; 
+	int errors = follow(&ff.fields[0]); 
+
+	srand(3); 
+	double repair_us = 0; 
+	const int ROUNDS = 100; 
+	for (uint32_t f = 1; f <= ROUNDS; f++) {
+		int n = 1 + rand() % 8; 
+		for (int i = 0; i < n; i++) {
+			BlockIndices b = {rand() % CHUNK_TILES, rand() % CHUNK_TILES, 1 - FLOW_RADIUS + rand() % (2*FLOW_RADIUS + 1),
+								-FLOW_RADIUS + rand() % (2*FLOW_RADIUS + 1)}; 
+			queue_tile_edit(&w, b, Tile {(char) (rand() % 2 ? TILE_AIR : TILE_DIRT), 0}); 
+		}
+		int applied = apply_tile_edits(&w, f); 
+		start = SDL_GetPerformanceCounter(); 
+		flow_tiles_changed(&ff, &w, w.journal.edits.data() + w.journal.edits.size() - applied, applied); 
+		repair_us += (SDL_GetPerformanceCounter() - start) / freq; 
+		fresh.fields.clear(); 
+		update_flow_fields(&fresh, &w, &target, 1, f); 
+		int diff = compare(&ff.fields[0], &fresh.fields[0]); 
+		if(diff > 0) {
+			printf("Frame %d: %d tiles differ from a full build\n", f, diff); 
+			errors += 1; 
+		}
+	}
+	errors += follow(&ff.fields[0]); 
+
+	//A chunk loading after the build opens up the field without the target moving.
+	World late; late.seed = 7; 
+	std::vector<ChunkIndices> first(cs.begin(), cs.end() - 1); 
+	gen_chunks(&late, &first); 
+	FlowFields lf; 
+	update_flow_fields(&lf, &late, &target, 1, 0); 
+	int corner = FLOW_SIDE*FLOW_SIDE - 1; 
+	bool corner_reached_before = lf.fields[0].dist[corner] != FLOW_UNREACHED || lf.fields[0].open[corner]; 
+	gen_chunk(&late, cs.back().row, cs.back().col); 
+	update_flow_fields(&lf, &late, &target, 1, 1); 
+	fresh.fields.clear(); 
+	update_flow_fields(&fresh, &late, &target, 1, 1); 
+	if(corner_reached_before || lf.rebuilds != 2 || compare(&lf.fields[0], &fresh.fields[0]) > 0) {
+		printf("Field didn't pick up a chunk loaded after it was built\n"); 
+		errors += 1; 
+	}
+	update_flow_fields(&lf, &late, &target, 1, 2); 
+	errors += lf.rebuilds != 2; 
+	printf("Full build %.1f us, repair after edits %.1f us on average\n", build_us, repair_us / ROUNDS); 
+	printf("%d errors\n", errors); 
+	return errors == 0 ? 0 : 1; 
+}
@@ -32,7 +32,7 @@ bool loadMedia() {
 int main( int argc, char* args[] ) {
     SDL_Texture *TILE_SHEET = loadTextureFromFile("resources/tile_sheet.png"); 
     SpriteSheet *sprite_sheet = new SpriteSheet("resources/sprite_entries.json"); 
-    std::vector<Particle> particles; 
+    ParticleSystem particles(PARTICLE_CAPACITY); 
 	Gamestate gamestate = Gamestate(sprite_sheet, &particles); 
 }
 
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include "../particle.hpp"
+
+int main( int argc, char* args[] ) {
+	int errors = 0; 
+
+	//Gravity pulls on y only, and positions trail velocities by a tick.
+	ParticleSystem ps(16); 
+	ParticleBurst falling = {pos: glm::dvec2(1, 2), vel: glm::dvec2(0.5, 0), spread: glm::dvec2(0, 0), dim: glm::dvec2(1, 1),
+								sprite: 1, count: 1, lifetime: 100, change_interval: 1, gravity: true}; 
+	emit_burst(&ps, &falling, 0); 
+	for (int t = 0; t < 10; t++) update_particles(&ps); 
+	float expected_y = 2 - PARTICLE_GRAVITY * (0 + 1 + 2 + 3 + 4 + 5 + 6 + 7 + 8 + 9); 
+	if(fabsf(ps.x[0] - 6) > 1e-4f || fabsf(ps.y[0] - expected_y) > 1e-4f || ps.vx[0] != 0.5f) {
+		printf("Particle at %f, %f, expected 6, %f\n", ps.x[0], ps.y[0], expected_y); 
+		errors += 1; 
+	}
+	if(fabsf(ps.prev_x[0] - 5.5f) > 1e-4f) {
+		printf("Previous position wasn't kept\n"); 
+		errors += 1; 
+	}
+
+	//Bursts past capacity are cut short and counted.
+	ParticleBurst burst = {pos: glm::dvec2(0, 0), vel: glm::dvec2(0, 0), spread: glm::dvec2(1, 1), dim: glm::dvec2(1, 1),
+							sprite: 2, count: 20, lifetime: 5, change_interval: 1, gravity: false}; 
+	int spawned = emit_burst(&ps, &burst, 7); 
+	if(spawned != 15 || ps.count != 16 || ps.dropped != 5) {
+		printf("Spawned %d of a burst into 15 free slots, %d dropped\n", spawned, ps.dropped); 
+		errors += 1; 
+	}
+	bool spread = false; 
+	for (int i = 1; i < ps.count; i++) {
+		if(fabsf(ps.vx[i]) > 1 || fabsf(ps.vy[i]) > 1) errors += 1; 
+		spread = spread || ps.vx[i] != ps.vx[1]; 
+	}
+	if(!spread) {
+		printf("Burst velocities weren't spread\n"); 
+		errors += 1; 
+	}
+
+	//Expired particles are swap-removed and the rest survive, whatever order they expire in.
+	for (int t = 0; t < 5; t++) update_particles(&ps); 
+	if(ps.count != 1 || ps.sprite[0] != 1) {
+		printf("%d particles left after the burst expired, expected 1\n", ps.count); 
+		errors += 1; 
+	}
+	ParticleSystem mixed(1000); 
+	for (int i = 0; i < 1000; i++) {
+		ParticleBurst b = burst; 
+		b.count = 1; 
+		b.lifetime = 1 + (i * 7919) % 50; 
+		b.sprite = b.lifetime; 
+		emit_burst(&mixed, &b, i); 
+	}
+	for (int t = 1; t <= 50; t++) {
+		update_particles(&mixed); 
+		int expected = 0; 
+		for (int i = 0; i < 1000; i++) expected += 1 + (i * 7919) % 50 > t; 
+		bool ages_ok = true; 
+		for (int i = 0; i < mixed.count; i++) ages_ok = ages_ok && mixed.age[i] == t && mixed.sprite[i] == mixed.lifetime[i]; 
+		if(mixed.count != expected || !ages_ok) {
+			printf("Tick %d: %d live particles, expected %d\n", t, mixed.count, expected); 
+			errors += 1; 
+			break; 
+		}
+	}
+
+	//Throughput with 100k live particles.
+	ParticleSystem big(PARTICLE_CAPACITY); 
+	ParticleBurst fountain = {pos: glm::dvec2(0, 0), vel: glm::dvec2(0, 0.3), spread: glm::dvec2(0.2, 0.1), dim: glm::dvec2(0.25, 0.25),
+								sprite: 1, count: 100000, lifetime: 60000, change_interval: 4, gravity: true}; 
+	emit_burst(&big, &fountain, 1); 
+	const int TICKS = 200; 
+	auto start = std::chrono::steady_clock::now(); 
+	for (int t = 0; t < TICKS; t++) update_particles(&big); 
+	double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / TICKS; 
+	printf("%d particles updated in %.1f us per tick\n", big.count, us); 
+
+	printf("%d errors\n", errors); 
+	return errors == 0 ? 0 : 1; 
+}
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include <SDL.h>
+#include "../pathfinding.hpp"
+
+const int REGION = 4; //Chunks per side.
+const int ROW0 = 0, COL0 = -2; //First chunk of the region.
+const int SIDE = REGION*CHUNK_TILES; 
+
+bool open_at(World *w, int row, int col) {
+	int cr = (row - ROW0*CHUNK_TILES) / CHUNK_TILES + ROW0; 
+	int cc = (col - COL0*CHUNK_TILES) / CHUNK_TILES + COL0; 
+	BlockIndices b = {row - cr*CHUNK_TILES, col - cc*CHUNK_TILES, cr, cc}; 
+	return query_tile(w, b).tile_id == TILE_AIR; 
+}
+
+//Shortest 4-connected distance over the whole region, -1 if unreachable.
+int flat_bfs(World *w, PathTile s, PathTile g) {
+	std::vector<int> dist(SIDE*SIDE, -1); 
+	std::vector<int> queue; 
+	int r0 = ROW0*CHUNK_TILES; int c0 = COL0*CHUNK_TILES; 
+	dist[(s.row - r0)*SIDE + s.col - c0] = 0; 
+	queue.push_back((s.row - r0)*SIDE + s.col - c0); 
+	for (int head = 0; head < queue.size(); head++) {
+		int i = queue[head]; 
+		int r = i / SIDE; int c = i % SIDE; 
+		if(r + r0 == g.row && c + c0 == g.col) return dist[i]; 
+		int dr[4] = {-1, 1, 0, 0}; int dc[4] = {0, 0, -1, 1}; 
+		for (int k = 0; k < 4; k++) {
+			int nr = r + dr[k]; int nc = c + dc[k]; 
+			if(nr < 0 || nr >= SIDE || nc < 0 || nc >= SIDE) continue; 
+			int n = nr*SIDE + nc; 
+			if(dist[n] < 0 && open_at(w, nr + r0, nc + c0)) {
+				dist[n] = dist[i] + 1; 
+				queue.push_back(n); 
+			}
+		}
+	}
+	return -1; 
+}
+
+//Path starts and ends at the right tiles, and every step is to an adjacent open tile.
+bool valid_path(World *w, PathResult *r, PathTile s, PathTile g) {
+	std::vector<PathTile> *t = &r->tiles; 
+	if(t->empty() || t->front().row != s.row || t->front().col != s.col || t->back().row != g.row || t->back().col != g.col) {
+		return false; 
+	}
+	for (int i = 0; i < t->size(); i++) {
+		if(!open_at(w, (*t)[i].row, (*t)[i].col)) return false; 
+		if(i > 0 && abs((*t)[i].row - (*t)[i-1].row) + abs((*t)[i].col - (*t)[i-1].col) != 1) return false; 
+	}
+	return true; 
+}
+
+PathTile random_open(World *w) {
+	while (true) {
+		PathTile t = {ROW0*CHUNK_TILES + rand() % SIDE, COL0*CHUNK_TILES + rand() % SIDE}; 
+		if(open_at(w, t.row, t.col)) return t; 
+	}
+}
+
+//Runs queries, checking each against flat BFS. Returns errors.
+int run_queries(World *w, Pathfinder *pf, int num, double *ratio, double *us) {
+	int errors = 0; 
+	double length = 0, optimal = 0; 
+	uint64_t ticks = 0; 
+	for (int q = 0; q < num; q++) {
+		PathTile s = random_open(w); PathTile g = random_open(w); 
+		uint64_t start = SDL_GetPerformanceCounter(); 
+		request_path(pf, s, g); 
+		while (pf->results.empty()) {
+			update_pathfinder(pf, w, PATH_TICK_BUDGET); 
+		}
+		ticks += SDL_GetPerformanceCounter() - start; 
+		PathResult r = pf->results.back(); 
+		pf->results.clear(); 
+		int best = flat_bfs(w, s, g); 
+		if((r.status == PATH_FOUND) != (best >= 0)) {
+			printf("(%d, %d) to (%d, %d): found %d, flat distance %d\n", s.row, s.col, g.row, g.col, r.status == PATH_FOUND, best); 
+			errors += 1; 
+		} else if(r.status == PATH_FOUND) {
+			if(!valid_path(w, &r, s, g)) {
+				printf("(%d, %d) to (%d, %d): invalid path\n", s.row, s.col, g.row, g.col); 
+				errors += 1; 
+			}
+			length += r.tiles.size() - 1; 
+			optimal += best; 
+		}
+	}
+	*ratio = optimal > 0 ? length / optimal : 1;
+	*us = ticks / (SDL_GetPerformanceFrequency() / 1e6) / num;
+	return errors; 
+}
+
+int main( int argc, char* args[] ) {
+	World w; w.seed = 11; 
+	std::vector<ChunkIndices> cs; 
+	for (int r = 0; r < REGION; r++) {
+		for (int c = 0; c < REGION; c++) {
+			cs.push_back({ROW0 + r, COL0 + c}); 
+		}
+	}
+	gen_chunks(&w, &cs); 
+	Pathfinder pf; 
+	srand(5); 
+	double ratio, us; 
+	int errors = run_queries(&w, &pf, 300, &ratio, &us); 
+	printf("Cold: %.1f us per query, path length %.3fx optimal, %d graphs built, %d expansions\n", us, ratio, pf.rebuilds, pf.expansions); 
+	errors += run_queries(&w, &pf, 300, &ratio, &us); 
+	printf("Warm: %.1f us per query, path length %.3fx optimal\n", us, ratio); 
+
+	//Carve a tunnel and wall off a column, then check paths follow the new terrain.
+	int rebuilds = pf.rebuilds; 
+	for (int i = 0; i < CHUNK_TILES; i++) {
+		queue_tile_edit(&w, {16, i, ROW0 + 1, COL0 + 1}, Tile {TILE_AIR, 0}); 
+		queue_tile_edit(&w, {i, 8, ROW0 + 2, COL0 + 2}, Tile {TILE_DIRT, 0}); 
+	}
+	apply_tile_edits(&w, 1); 
+	invalidate_path_graphs(&pf, &w.journal.touched); 
+	errors += run_queries(&w, &pf, 300, &ratio, &us); 
+	printf("After edits: %.1f us per query, path length %.3fx optimal, %d graphs rebuilt\n", us, ratio, pf.rebuilds - rebuilds); 
+
+	//Many requests spread over ticks under the per-tick budget.
+	for (int q = 0; q < 500; q++) {
+		request_path(&pf, random_open(&w), random_open(&w)); 
+	}
+	int ticks = 0; 
+	while (pf.results.size() < 500) {
+		update_pathfinder(&pf, &w, PATH_TICK_BUDGET); 
+		ticks += 1; 
+	}
+	printf("500 queued requests finished in %d ticks\n", ticks); 
+
+	//Graphs of unloaded chunks are dropped before the next search.
+	for (int r = 0; r < REGION; r++) {
+		unload_chunk(&w, {ROW0 + r, COL0 + REGION - 1}); 
+	}
+	request_path(&pf, random_open(&w), random_open(&w)); 
+	while (pf.results.size() < 501) {
+		update_pathfinder(&pf, &w, PATH_TICK_BUDGET); 
+	}
+	for (auto it = pf.graphs.begin(); it != pf.graphs.end(); it++) {
+		if(query_chunk(&w, it->first) == nullptr) {
+			printf("Graph kept for unloaded chunk %d %d\n", it->first.row, it->first.col); 
+			errors += 1; 
+		}
+	}
+	printf("%d errors\n", errors); 
+	return errors == 0 ? 0 : 1; 
+}
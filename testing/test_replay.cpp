@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <string.h>
+#include "../replay.hpp"
+
+int main( int argc, char* args[] ) {
+	int errors = 0; 
+	Replay r; 
+	for (int i = 0; i < 1000; i++) {
+		InputState s = {0}; 
+		s.x = i % 3 - 1; 
+		s.y = (i / 3) % 3 - 1; 
+		s.mouse_down = i % 5 == 0; 
+		s.right_mouse_down = i % 7 == 0; 
+		s.j = i % 11 == 0; 
+		s.mouse_pos.x = i % 640; 
+		s.mouse_pos.y = 479 - i % 480; 
+		record_input(&r, &s); 
+	}
+
+	//Saved and loaded, every tick's input comes back as recorded.
+	const char *path = "test_replay.rply"; 
+	if(!save_replay(&r, path)) return 1; 
+	Replay loaded; 
+	if(!load_replay(&loaded, path) || loaded.inputs.size() != 1000) {
+		printf("Replay wasn't read back\n"); 
+		return 1; 
+	}
+	for (int i = 0; i < 1000; i++) {
+		InputState s = replay_input(&loaded, i); 
+		if(s.x != i % 3 - 1 || s.y != (i / 3) % 3 - 1 || s.mouse_down != (i % 5 == 0) || s.right_mouse_down != (i % 7 == 0) ||
+				s.j != (i % 11 == 0) || s.mouse_pos.x != i % 640 || s.mouse_pos.y != 479 - i % 480) {
+			printf("Tick %d input differs\n", i); 
+			errors += 1; 
+		}
+	}
+	InputState past_end = replay_input(&loaded, 1000); 
+	if(past_end.x != 0 || past_end.mouse_down || past_end.j) {
+		printf("Input held past the end of the replay\n"); 
+		errors += 1; 
+	}
+
+	//Truncated files are rejected.
+	FILE *f = fopen(path, "r+b"); 
+	fseek(f, 0, SEEK_END); 
+	long size = ftell(f); 
+	fclose(f); 
+	char *bytes = new char[size]; 
+	f = fopen(path, "rb"); 
+	fread(bytes, 1, size, f); 
+	fclose(f); 
+	f = fopen(path, "wb"); 
+	fwrite(bytes, 1, size - 3, f); 
+	fclose(f); 
+	delete[] bytes; 
+	if(load_replay(&loaded, path) || loaded.inputs.size() != 0) {
+		printf("Loaded a truncated replay\n"); 
+		errors += 1; 
+	}
+	remove(path); 
+	printf("%d errors\n", errors); 
+	return errors == 0 ? 0 : 1; 
+}
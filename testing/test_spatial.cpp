@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <SDL.h>
+#include "../spatial.hpp"
+
+const int ENTITIES = 10000; 
+const double SPREAD = 16*CHUNK_WIDTH; //Entities spread over 16x16 chunks, centered on 0.
+
+double frand(double lo, double hi) {
+	return lo + (hi - lo) * rand() / (double) RAND_MAX; 
+}
+
+//Query results must match a scan over every entity, up to order.
+int check_radius(SpatialIndex *s, std::vector<glm::dvec2> *pos, glm::dvec2 c, double r, int *out) {
+	int n = spatial_query_radius(s, c, r, out, ENTITIES); 
+	std::vector<int> expected; 
+	for (int i = 0; i < pos->size(); i++) {
+		if(glm::dot((*pos)[i] - c, (*pos)[i] - c) <= r*r) expected.push_back(i); 
+	}
+	std::sort(out, out + n); 
+	return n == expected.size() && std::equal(expected.begin(), expected.end(), out) ? 0 : 1; 
+}
+
+int check_aabb(SpatialIndex *s, std::vector<glm::dvec2> *pos, glm::dvec2 lo, glm::dvec2 hi, int *out) {
+	int n = spatial_query_aabb(s, lo, hi, out, ENTITIES); 
+	std::vector<int> expected; 
+	for (int i = 0; i < pos->size(); i++) {
+		glm::dvec2 p = (*pos)[i]; 
+		if(p.x >= lo.x && p.x <= hi.x && p.y >= lo.y && p.y <= hi.y) expected.push_back(i); 
+	}
+	std::sort(out, out + n); 
+	return n == expected.size() && std::equal(expected.begin(), expected.end(), out) ? 0 : 1; 
+}
+
+//Nearest distances must match the k smallest of a full scan. Ids may differ on ties.
+int check_nearest(SpatialIndex *s, std::vector<glm::dvec2> *pos, glm::dvec2 c, int k, int *out) {
+	int n = spatial_query_nearest(s, c, k, INFINITY, out); 
+	std::vector<double> d2; 
+	for (int i = 0; i < pos->size(); i++) d2.push_back(glm::dot((*pos)[i] - c, (*pos)[i] - c)); 
+	std::sort(d2.begin(), d2.end()); 
+	if(n != std::min(k, (int) d2.size())) return 1; 
+	for (int i = 0; i < n; i++) {
+		glm::dvec2 p = (*pos)[out[i]]; 
+		if(glm::dot(p - c, p - c) != d2[i]) return 1; 
+	}
+	return 0; 
+}
+
+int main( int argc, char* args[] ) {
+	srand(5); 
+	SpatialIndex s; 
+	std::vector<glm::dvec2> pos(ENTITIES); 
+	std::vector<int> out(ENTITIES); 
+	for (int i = 0; i < ENTITIES; i++) {
+		pos[i] = glm::dvec2(frand(-SPREAD/2, SPREAD/2), frand(-SPREAD/2, SPREAD/2)); 
+		spatial_update(&s, i, pos[i], 0); 
+	}
+	double freq = SDL_GetPerformanceFrequency() / 1e6; 
+	int errors = 0; 
+
+	//Move everything a little each tick, as physics would, and delete a few entities.
+	const int TICKS = 60; 
+	uint64_t start = SDL_GetPerformanceCounter(); 
+	for (uint32_t t = 1; t <= TICKS; t++) {
+		for (int i = 0; i < ENTITIES; i++) {
+			if(pos[i].x == INFINITY) continue; 
+			pos[i] += glm::dvec2(frand(-0.5, 0.5), frand(-0.5, 0.5)); 
+			spatial_update(&s, i, pos[i], t); 
+		}
+	}
+	double update_us = (SDL_GetPerformanceCounter() - start) / freq / TICKS; 
+	for (int i = 0; i < ENTITIES; i += 10) {
+		pos[i].x = INFINITY; 
+	}
+	for (int i = 0; i < ENTITIES; i++) {
+		if(pos[i].x != INFINITY) spatial_update(&s, i, pos[i], TICKS + 1); 
+	}
+	spatial_remove_stale(&s, TICKS + 1); 
+	if(s.count != ENTITIES - ENTITIES / 10) {
+		printf("%d entities indexed after removal\n", s.count); 
+		errors += 1; 
+	}
+	std::vector<glm::dvec2> live; 
+	std::vector<int> live_id; 
+	for (int i = 0; i < ENTITIES; i++) {
+		if(pos[i].x != INFINITY) {
+			live.push_back(pos[i]); 
+			live_id.push_back(i); 
+		}
+	}
+	//Checks compare against positions indexed by id, so give stale ids unreachable positions.
+	std::vector<glm::dvec2> by_id = pos; 
+	for (int i = 0; i < ENTITIES; i += 10) by_id[i] = glm::dvec2(1e18, 1e18); 
+
+	for (int q = 0; q < 200; q++) {
+		glm::dvec2 c = glm::dvec2(frand(-SPREAD/2, SPREAD/2), frand(-SPREAD/2, SPREAD/2)); 
+		double r = frand(1, 40); 
+		errors += check_radius(&s, &by_id, c, r, out.data()); 
+		errors += check_aabb(&s, &by_id, c - glm::dvec2(r, r/2), c + glm::dvec2(r/2, r), out.data()); 
+		errors += check_nearest(&s, &by_id, c, 1 + q % 16, out.data()); 
+	}
+
+	//Timing against a scan over every entity.
+	const int QUERIES = 1000; 
+	int found = 0; 
+	start = SDL_GetPerformanceCounter(); 
+	for (int q = 0; q < QUERIES; q++) {
+		glm::dvec2 c = glm::dvec2(frand(-SPREAD/2, SPREAD/2), frand(-SPREAD/2, SPREAD/2)); 
+		found += spatial_query_radius(&s, c, 16, out.data(), ENTITIES); 
+	}
+	double radius_us = (SDL_GetPerformanceCounter() - start) / freq / QUERIES; 
+	start = SDL_GetPerformanceCounter(); 
+	for (int q = 0; q < QUERIES; q++) {
+		glm::dvec2 c = glm::dvec2(frand(-SPREAD/2, SPREAD/2), frand(-SPREAD/2, SPREAD/2)); 
+		found += spatial_query_nearest(&s, c, 8, INFINITY, out.data()); 
+	}
+	double nearest_us = (SDL_GetPerformanceCounter() - start) / freq / QUERIES; 
+	start = SDL_GetPerformanceCounter(); 
+	for (int q = 0; q < QUERIES; q++) {
+		glm::dvec2 c = glm::dvec2(frand(-SPREAD/2, SPREAD/2), frand(-SPREAD/2, SPREAD/2)); 
+		for (int i = 0; i < live.size(); i++) {
+			if(glm::dot(live[i] - c, live[i] - c) <= 16*16) out[found++ % ENTITIES] = live_id[i]; 
+		}
+	}
+	double scan_us = (SDL_GetPerformanceCounter() - start) / freq / QUERIES; 
+
+	printf("%d entities: update %.1f us per tick\n", ENTITIES, update_us); 
+	printf("Radius 16 query %.2f us, 8 nearest %.2f us, full scan %.2f us\n", radius_us, nearest_us, scan_us); 
+	printf("%d errors\n", errors); 
+	return errors == 0 ? 0 : 1; 
+}
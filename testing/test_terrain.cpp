@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include <SDL.h>
+#include "../terrain.hpp"
+
+//Chunks generated serially, in parallel, and one at a time in a different order must match. 
+int main( int argc, char* args[] ) {
+	std::vector<ChunkIndices> chunk_list; 
+	for (int r = -8; r < 8; r++) {
+		for (int c = -8; c < 8; c++) {
+			chunk_list.push_back({r, c}); 
+		}
+	}
+
+	World serial; serial.seed = 1234; 
+	World parallel; parallel.seed = 1234; 
+
+	uint32_t start = SDL_GetTicks(); 
+	for (int i = 0; i < chunk_list.size(); i++) {
+		gen_chunk(&serial, chunk_list[i].row, chunk_list[i].col); 
+	}
+	uint32_t serial_ticks = SDL_GetTicks() - start; 
+
+	start = SDL_GetTicks(); 
+	gen_chunks(&parallel, &chunk_list); 
+	uint32_t parallel_ticks = SDL_GetTicks() - start; 
+
+	int mismatches = 0; 
+	for (int i = 0; i < chunk_list.size(); i++) {
+		Chunk *a = query_chunk(&serial, chunk_list[i]); 
+		Chunk *b = query_chunk(&parallel, chunk_list[i]); 
+		if(a == nullptr || b == nullptr || memcmp(a->tiles, b->tiles, sizeof(a->tiles)) != 0) {
+			mismatches += 1; 
+		}
+	}
+
+	//Regenerate a single chunk after the rest of the world exists. 
+	Chunk c = {row: -3, col: 5}; 
+	gen_chunk_tiles(&c, 1234, &serial.terrain); 
+	if(memcmp(c.tiles, query_chunk(&serial, {-3, 5})->tiles, sizeof(c.tiles)) != 0) {
+		mismatches += 1; 
+	}
+
+	int solid = 0; int ore = 0; 
+	for (int i = 0; i < CHUNK_TILES*CHUNK_TILES; i++) {
+		solid += c.tiles[i].tile_id > 0; 
+		ore += c.tiles[i].tile_id == TILE_ORE; 
+	}
+
+	//Single thread throughput of the full pipeline. 
+	const int BENCH_CHUNKS = 4096; 
+	TerrainParams tp; 
+	start = SDL_GetTicks(); 
+	for (int i = 0; i < BENCH_CHUNKS; i++) {
+		Chunk b = {row: i / 64 - 32, col: i % 64 - 32}; 
+		gen_chunk_tiles(&b, 99, &tp); 
+	}
+	uint32_t bench_ticks = SDL_GetTicks() - start; 
+	printf("Generated %d chunks: serial %d ms, parallel %d ms\n", chunk_list.size(), serial_ticks, parallel_ticks); 
+	printf("Chunk (-3, 5) has %d solid tiles, %d ore\n", solid, ore); 
+	printf("Single thread: %d chunks in %d ms, %.0f chunks/s\n", BENCH_CHUNKS, bench_ticks, 
+			1000.0 * BENCH_CHUNKS / (bench_ticks + 1)); 
+	printf("%d mismatched chunks\n", mismatches); 
+	return mismatches == 0 ? 0 : 1; 
+}
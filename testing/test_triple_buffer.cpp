@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include "../triple_buffer.hpp"
+
+struct Frame {
+	int seq; 
+	std::vector<int> values; //Every entry is seq, so a torn read shows up as a mismatch.
+}; 
+
+int main( int argc, char* args[] ) {
+	int errors = 0; 
+
+	//Single thread: nothing is read before a publish, and the newest publish wins.
+	TripleBuffer<Frame> b; 
+	if(b.take() || !b.taken()) errors += 1; 
+	for (int i = 1; i <= 3; i++) {
+		b.write_slot()->seq = i; 
+		b.publish(); 
+	}
+	if(b.taken()) {
+		printf("Writer saw a publish as taken before the reader took it\n"); 
+		errors += 1; 
+	}
+	if(!b.take() || b.read_slot()->seq != 3) {
+		printf("Reader didn't get the newest value\n"); 
+		errors += 1; 
+	}
+	if(b.take()) {
+		printf("Took a value twice\n"); 
+		errors += 1; 
+	}
+	if(!b.taken()) {
+		printf("Writer didn't see the reader take\n"); 
+		errors += 1; 
+	}
+
+	//Two threads: reads are never torn, never go backwards, and the writer never waits.
+	const int PUBLISHES = 200000; 
+	TripleBuffer<Frame> t; 
+	int torn = 0, backwards = 0, taken = 0; 
+	std::thread reader([&]() {
+		int last = 0; 
+		while (last < PUBLISHES) {
+			if(!t.take()) continue; 
+			const Frame *f = t.read_slot(); 
+			for (int i = 0; i < f->values.size(); i++) {
+				if(f->values[i] != f->seq) {
+					torn += 1; 
+					break; 
+				}
+			}
+			if(f->seq <= last) backwards += 1; 
+			last = f->seq; 
+			taken += 1; 
+		}
+	}); 
+	auto start = std::chrono::steady_clock::now(); 
+	for (int seq = 1; seq <= PUBLISHES; seq++) {
+		Frame *f = t.write_slot(); 
+		f->seq = seq; 
+		f->values.assign(64, seq); 
+		t.publish(); 
+	}
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(); 
+	reader.join(); 
+	printf("%d publishes in %.1f ms, reader took %d\n", PUBLISHES, ms, taken); 
+	if(torn > 0 || backwards > 0) {
+		printf("%d torn reads, %d out of order\n", torn, backwards); 
+		errors += 1; 
+	}
+	printf("%d errors\n", errors); 
+	return errors == 0 ? 0 : 1; 
+}
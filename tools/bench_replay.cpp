@@ -0,0 +1,168 @@
+/*
+Replays a recorded session (see replay.hpp) without a display and reports how long each frame
+took to simulate and to render. Runs under SDL's dummy video driver with a software renderer
+drawing into memory, so it works on machines with no display or GPU.
+
+Every HASH_INTERVAL ticks the rendered frame is hashed. --save writes the hashes to a file and
+--check compares against a saved file, failing on any difference, so a replay doubles as a
+rendering regression test.
+
+Usage: bench_replay <replay> [--save <hashes> | --check <hashes>]
+Record a replay by running the game with --record <replay>.
+*/
+#include <SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include "../renderer.hpp"
+#include "../game_world.hpp"
+#include "../chunk_render.hpp"
+#include "../simulation.hpp"
+#include "../scene_render.hpp"
+#include "../replay.hpp"
+
+const int HASH_INTERVAL = 50; 
+
+struct FrameHash {
+	int tick; 
+	uint64_t hash; 
+}; 
+
+static double percentile(std::vector<double> v, double p) {
+	if(v.empty()) return 0; 
+	std::sort(v.begin(), v.end()); 
+	return v[std::min((int) v.size() - 1, (int) (p * v.size()))]; 
+}
+
+static double mean(std::vector<double> *v) {
+	double sum = 0; 
+	for (int i = 0; i < v->size(); i++) sum += (*v)[i]; 
+	return v->empty() ? 0 : sum / v->size(); 
+}
+
+static void report(const char *name, std::vector<double> *ms) {
+	printf("%-8s mean %7.3f ms  p50 %7.3f  p95 %7.3f  p99 %7.3f  max %7.3f\n", name, mean(ms),
+			percentile(*ms, 0.5), percentile(*ms, 0.95), percentile(*ms, 0.99), percentile(*ms, 1.0)); 
+}
+
+static bool save_hashes(std::vector<FrameHash> *hashes, const char *path) {
+	FILE *f = fopen(path, "w"); 
+	if(f == NULL) {
+		printf("Unable to open %s for writing\n", path); 
+		return false; 
+	}
+	for (int i = 0; i < hashes->size(); i++) {
+		fprintf(f, "%d %016llx\n", (*hashes)[i].tick, (unsigned long long) (*hashes)[i].hash); 
+	}
+	fclose(f); 
+	return true; 
+}
+
+//Returns the number of frames that differ from the saved hashes, or -1 if they can't be read.
+static int check_hashes(std::vector<FrameHash> *hashes, const char *path) {
+	FILE *f = fopen(path, "r"); 
+	if(f == NULL) {
+		printf("Unable to open %s\n", path); 
+		return -1; 
+	}
+	std::vector<FrameHash> saved; 
+	int tick; 
+	unsigned long long hash; 
+	while (fscanf(f, "%d %llx", &tick, &hash) == 2) {
+		saved.push_back(FrameHash {tick, hash}); 
+	}
+	fclose(f); 
+	int differences = 0; 
+	if(saved.size() != hashes->size()) {
+		printf("Expected %d hashed frames, rendered %d\n", (int) saved.size(), (int) hashes->size()); 
+		differences += 1; 
+	}
+	for (int i = 0; i < std::min(saved.size(), hashes->size()); i++) {
+		if(saved[i].tick != (*hashes)[i].tick || saved[i].hash != (*hashes)[i].hash) {
+			printf("Frame at tick %d differs\n", (*hashes)[i].tick); 
+			differences += 1; 
+		}
+	}
+	return differences; 
+}
+
+int main( int argc, char* args[] ) {
+	if(argc != 2 && !(argc == 4 && (strcmp(args[2], "--save") == 0 || strcmp(args[2], "--check") == 0))) {
+		printf("Usage: bench_replay <replay> [--save <hashes> | --check <hashes>]\n"); 
+		return 1; 
+	}
+	Replay replay; 
+	if(!load_replay(&replay, args[1])) return 1; 
+	if(!init_headless()) {
+		printf("Failed to initialize!\n"); 
+		return 1; 
+	}
+	SpriteSheet *sheet = loadSpriteSheet("resources/sprites.bin"); 
+	if(sheet == NULL) {
+		printf("Failed to load media!\n"); 
+		return 1; 
+	}
+
+	//Same view as the game.
+	Camera camera; 
+	camera.pos = glm::dvec2(0, 0); 
+	camera.dim = glm::dvec2(16, 16); 
+	camera.SCREEN_HEIGHT = SCREEN_HEIGHT; 
+	camera.SCREEN_WIDTH = SCREEN_WIDTH; 
+	glm::dvec2 camera_offset = glm::dvec2(8, 8); 
+
+	ParticleSystem particles(PARTICLE_CAPACITY); 
+	Gamestate gamestate = Gamestate(sheet, &particles); 
+	setup_session(&gamestate); 
+	RollbackECS *ecs = gamestate.ecs; 
+	ChunkTextures chunk_textures(sheet); 
+	SpriteBatch sprite_batch; 
+	RenderSnapshot snapshot; 
+	std::vector<BlockIndices> block_indices; 
+	std::vector<int> visible; 
+
+	std::vector<double> sim_ms, frame_ms; 
+	std::vector<FrameHash> hashes; 
+	double ticks_per_ms = SDL_GetPerformanceFrequency() / 1000.0; 
+	for (int tick = 0; tick < replay.inputs.size(); tick++) {
+		//Ticks run as on the simulation thread, and each is drawn once, exactly at its own positions.
+		Uint64 t0 = SDL_GetPerformanceCounter(); 
+		Entity *pe = &ecs->entities[ecs->entity_map[ecs->player_data[0].entity_id]]; 
+		camera.pos = pe->pos - camera_offset; 
+		simulate_tick(&gamestate, replay_input(&replay, tick), camera, &block_indices); 
+		pe = &ecs->entities[ecs->entity_map[ecs->player_data[0].entity_id]]; 
+		camera.pos = pe->pos - camera_offset; 
+		take_snapshot(&gamestate, camera, &snapshot, &visible); 
+		Uint64 t1 = SDL_GetPerformanceCounter(); 
+
+		render_snapshot(&snapshot, 1.0, camera, sheet, &chunk_textures, &sprite_batch); 
+		Uint64 t2 = SDL_GetPerformanceCounter(); 
+		if(tick % HASH_INTERVAL == 0) {
+			hashes.push_back(FrameHash {tick, hash_frame()}); 
+		}
+		Uint64 t3 = SDL_GetPerformanceCounter(); 
+		SDL_RenderPresent(gRenderer); 
+		trim_chunk_textures(&chunk_textures); 
+		Uint64 t4 = SDL_GetPerformanceCounter(); 
+
+		sim_ms.push_back((t1 - t0) / ticks_per_ms); 
+		frame_ms.push_back(((t2 - t1) + (t4 - t3)) / ticks_per_ms); 
+	}
+
+	printf("Replayed %d ticks at %d x %d\n", (int) replay.inputs.size(), SCREEN_WIDTH, SCREEN_HEIGHT); 
+	report("simulate", &sim_ms); 
+	report("render", &frame_ms); 
+
+	int status = 0; 
+	if(argc == 4 && strcmp(args[2], "--save") == 0) {
+		status = save_hashes(&hashes, args[3]) ? 0 : 1; 
+	} else if(argc == 4) {
+		int differences = check_hashes(&hashes, args[3]); 
+		if(differences >= 0) printf("%d of %d hashed frames differ\n", differences, (int) hashes.size()); 
+		status = differences == 0 ? 0 : 1; 
+	}
+	free_chunk_textures(&chunk_textures); 
+	close_SDL(); 
+	return status; 
+}
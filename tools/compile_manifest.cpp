@@ -0,0 +1,63 @@
+/*
+Compiles a sprite_entries.json, and optionally a tile strip, into the binary sprite manifest
+loadSpriteSheet maps at startup (see atlas.hpp). Sprites keep their place in the JSON's texture,
+which becomes page 0. A tile strip becomes page 1, with tile id t at cell t-1.
+
+Usage: compile_manifest <sprite_entries.json> <out.bin> [<tile sheet png> <tile pixels> <tile count>]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <json.hpp>
+#include "../atlas.hpp"
+
+using json = nlohmann::json; 
+
+int main( int argc, char* args[] ) {
+	if(argc != 3 && argc != 6) {
+		printf("Usage: compile_manifest <sprite_entries.json> <out.bin> [<tile sheet png> <tile pixels> <tile count>]\n"); 
+		return 1; 
+	}
+	std::ifstream ifs(args[1]); 
+	if(!ifs) {
+		printf("Unable to open %s\n", args[1]); 
+		return 1; 
+	}
+	json j = json::parse(ifs); 
+	std::vector<std::string> pages; 
+	std::vector<ManifestSprite> sprites; 
+	std::vector<AtlasTile> tiles; 
+	pages.push_back(j["texture_path"].get<std::string>()); 
+	for (auto& entry : j["sprite_entries"].items()) {
+		json location = entry.value()["location"]; 
+		ManifestSprite s = {}; 
+		s.name = entry.key(); 
+		s.page = 0; 
+		s.frames = entry.value()["frames"].get<int>(); 
+		s.x = location[0].get<int>(); s.y = location[1].get<int>(); 
+		s.w = location[2].get<int>(); s.h = location[3].get<int>(); 
+		sprites.push_back(s); 
+	}
+	if(argc == 6) {
+		pages.push_back(args[3]); 
+		int tile_pixels = atoi(args[4]); 
+		int tile_count = atoi(args[5]); 
+		for (int i = 0; i < tile_count; i++) {
+			tiles.push_back(AtlasTile {1, 0, i*tile_pixels, 0, tile_pixels, tile_pixels}); 
+		}
+	}
+
+	std::vector<char> manifest; 
+	write_manifest(&manifest, &pages, sprites, &tiles); 
+	FILE *f = fopen(args[2], "wb"); 
+	if(f == NULL) {
+		printf("Unable to open %s for writing\n", args[2]); 
+		return 1; 
+	}
+	fwrite(manifest.data(), 1, manifest.size(), f); 
+	fclose(f); 
+	printf("Wrote %d sprites and %d tiles, %d bytes\n", (int) sprites.size(), (int) tiles.size(), (int) manifest.size()); 
+	return 0; 
+}
@@ -0,0 +1,220 @@
+/*
+Packs the tile strip and every sprite in a sprite_entries.json into atlas pages, and writes
+the pages as PNGs plus a binary sprite manifest (see atlas.hpp) for loadSpriteSheet.
+
+Usage: pack_atlas <out prefix> <tile sheet png> <tile pixels> <sprite_entries.json>
+Writes <out prefix>_<page>.png and <out prefix>.bin.
+
+Rects are placed with a skyline bottom-left packer: the top edge of everything placed so far is
+kept as a list of horizontal segments, and each rect goes where its top ends lowest, leftmost on
+ties. Rects are packed tallest first. Anything that doesn't fit starts a new page.
+*/
+#include <SDL.h>
+#include <SDL_image.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <json.hpp>
+#include "../atlas.hpp"
+
+using json = nlohmann::json; 
+
+const int ATLAS_PAGE_PIXELS = 2048; 
+const int ATLAS_PADDING = 1; //Empty pixels around each rect, so filtering doesn't bleed neighbours in.
+
+struct PackRect {
+	SDL_Surface *source; 
+	SDL_Rect src; 
+	int sprite; //Index into sprites, or -1 for a tile.
+	int tile; //Index into tiles, or -1 for a sprite.
+	int page, x, y; //Placement, filled in by packing.
+}; 
+
+struct SkylineSegment {
+	int x, y, w; 
+}; 
+
+struct Skyline {
+	std::vector<SkylineSegment> segments; 
+	int width, height; 
+}; 
+
+static void skyline_init(Skyline *s, int width, int height) {
+	s->width = width; s->height = height; 
+	s->segments.assign(1, SkylineSegment {0, 0, width}); 
+}
+
+//Lowest y a w wide rect can sit at starting on segment i, or -1 if it runs off the right edge.
+static int skyline_fit(Skyline *s, int i, int w) {
+	int x = s->segments[i].x; 
+	if(x + w > s->width) return -1; 
+	int y = 0; 
+	for (int j = i; j < s->segments.size() && s->segments[j].x < x + w; j++) {
+		y = std::max(y, s->segments[j].y); 
+	}
+	return y; 
+}
+
+//Places a w x h rect, returning false if the page is full.
+static bool skyline_place(Skyline *s, int w, int h, int *out_x, int *out_y) {
+	int best = -1, best_top = 0, best_y = 0; 
+	for (int i = 0; i < s->segments.size(); i++) {
+		int y = skyline_fit(s, i, w); 
+		if(y < 0 || y + h > s->height) continue; 
+		if(best < 0 || y + h < best_top) {
+			best = i; best_top = y + h; best_y = y; 
+		}
+	}
+	if(best < 0) return false; 
+	int x = s->segments[best].x; 
+	*out_x = x; *out_y = best_y;
+	//New segment over [x, x + w), then trim the segments it covers.
+	s->segments.insert(s->segments.begin() + best, SkylineSegment {x, best_y + h, w}); 
+	int i = best + 1; 
+	while (i < s->segments.size() && s->segments[i].x < x + w) {
+		SkylineSegment *seg = &s->segments[i]; 
+		int end = seg->x + seg->w; 
+		if(end <= x + w) {
+			s->segments.erase(s->segments.begin() + i); 
+		} else {
+			seg->w = end - (x + w); 
+			seg->x = x + w; 
+			break; 
+		}
+	}
+	//Merge neighbours of equal height.
+	for (int j = 0; j + 1 < s->segments.size();) {
+		if(s->segments[j].y == s->segments[j+1].y) {
+			s->segments[j].w += s->segments[j+1].w; 
+			s->segments.erase(s->segments.begin() + j + 1); 
+		} else {
+			j++; 
+		}
+	}
+	return true; 
+}
+
+//Assigns page, x and y to every rect. Returns the number of pages used, or -1 if a rect is
+//larger than a page.
+static int pack(std::vector<PackRect> *rects) {
+	std::vector<int> order(rects->size()); 
+	for (int i = 0; i < order.size(); i++) order[i] = i; 
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+		return (*rects)[a].src.h > (*rects)[b].src.h; 
+	}); 
+	std::vector<Skyline> pages; 
+	for (int k = 0; k < order.size(); k++) {
+		PackRect *r = &(*rects)[order[k]]; 
+		int w = r->src.w + 2*ATLAS_PADDING; int h = r->src.h + 2*ATLAS_PADDING; 
+		if(w > ATLAS_PAGE_PIXELS || h > ATLAS_PAGE_PIXELS) {
+			printf("Rect of %d x %d doesn't fit on a %d pixel page\n", r->src.w, r->src.h, ATLAS_PAGE_PIXELS); 
+			return -1; 
+		}
+		int x, y; 
+		bool placed = false; 
+		for (int p = 0; p < pages.size() && !placed; p++) {
+			if(skyline_place(&pages[p], w, h, &x, &y)) {
+				r->page = p; 
+				placed = true; 
+			}
+		}
+		if(!placed) {
+			pages.push_back(Skyline()); 
+			skyline_init(&pages.back(), ATLAS_PAGE_PIXELS, ATLAS_PAGE_PIXELS); 
+			skyline_place(&pages.back(), w, h, &x, &y); 
+			r->page = pages.size() - 1; 
+		}
+		r->x = x + ATLAS_PADDING; r->y = y + ATLAS_PADDING; 
+	}
+	return pages.size(); 
+}
+
+static SDL_Surface* load_rgba(const char *path) {
+	SDL_Surface *loaded = IMG_Load(path); 
+	if(loaded == NULL) {
+		printf("Unable to load image %s! SDL_image Error: %s\n", path, IMG_GetError()); 
+		return NULL; 
+	}
+	SDL_Surface *rgba = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0); 
+	SDL_FreeSurface(loaded); 
+	return rgba; 
+}
+
+int main( int argc, char* args[] ) {
+	if(argc != 5) {
+		printf("Usage: pack_atlas <out prefix> <tile sheet png> <tile pixels> <sprite_entries.json>\n"); 
+		return 1; 
+	}
+	std::string prefix = args[1]; 
+	int tile_pixels = atoi(args[3]); 
+	std::vector<PackRect> rects; 
+	std::vector<ManifestSprite> sprites; 
+	std::vector<AtlasTile> tiles; 
+
+	//Tiles, one per cell of the strip.
+	SDL_Surface *tile_sheet = load_rgba(args[2]); 
+	if(tile_sheet == NULL || tile_pixels <= 0) return 1; 
+	for (int x = 0; x + tile_pixels <= tile_sheet->w; x += tile_pixels) {
+		rects.push_back(PackRect {tile_sheet, SDL_Rect {x, 0, tile_pixels, tile_pixels}, -1, (int) tiles.size()}); 
+		tiles.push_back(AtlasTile {}); 
+	}
+
+	//Sprites, each strip of frames kept whole.
+	std::ifstream ifs(args[4]); 
+	json j = json::parse(ifs); 
+	SDL_Surface *sprite_sheet = load_rgba(j["texture_path"].get<std::string>().c_str()); 
+	if(sprite_sheet == NULL) return 1; 
+	for (auto& entry : j["sprite_entries"].items()) {
+		json location = entry.value()["location"]; 
+		ManifestSprite s = {}; 
+		s.name = entry.key(); 
+		s.frames = entry.value()["frames"].get<int>(); 
+		rects.push_back(PackRect {sprite_sheet, SDL_Rect {location[0].get<int>(), location[1].get<int>(),
+								location[2].get<int>(), location[3].get<int>()}, (int) sprites.size(), -1}); 
+		sprites.push_back(s); 
+	}
+
+	int page_count = pack(&rects); 
+	if(page_count < 0) return 1; 
+
+	std::vector<SDL_Surface*> pages; 
+	std::vector<std::string> page_paths; 
+	for (int p = 0; p < page_count; p++) {
+		pages.push_back(SDL_CreateRGBSurfaceWithFormat(0, ATLAS_PAGE_PIXELS, ATLAS_PAGE_PIXELS, 32, SDL_PIXELFORMAT_RGBA32)); 
+		page_paths.push_back(prefix + "_" + std::to_string(p) + ".png"); 
+	}
+	for (int i = 0; i < rects.size(); i++) {
+		PackRect *r = &rects[i]; 
+		SDL_Rect dest = {r->x, r->y, r->src.w, r->src.h}; 
+		SDL_SetSurfaceBlendMode(r->source, SDL_BLENDMODE_NONE); 
+		SDL_BlitSurface(r->source, &r->src, pages[r->page], &dest); 
+		if(r->sprite >= 0) {
+			ManifestSprite *s = &sprites[r->sprite]; 
+			s->page = r->page; s->x = r->x; s->y = r->y; s->w = r->src.w; s->h = r->src.h; 
+		} else {
+			tiles[r->tile] = AtlasTile {(uint16_t) r->page, 0, r->x, r->y, r->src.w, r->src.h}; 
+		}
+	}
+	for (int p = 0; p < page_count; p++) {
+		if(IMG_SavePNG(pages[p], page_paths[p].c_str()) != 0) {
+			printf("Unable to save %s! SDL_image Error: %s\n", page_paths[p].c_str(), IMG_GetError()); 
+			return 1; 
+		}
+	}
+
+	std::vector<char> manifest; 
+	write_manifest(&manifest, &page_paths, sprites, &tiles); 
+	std::string manifest_path = prefix + ".bin"; 
+	FILE *f = fopen(manifest_path.c_str(), "wb"); 
+	if(f == NULL) {
+		printf("Unable to open %s for writing\n", manifest_path.c_str()); 
+		return 1; 
+	}
+	fwrite(manifest.data(), 1, manifest.size(), f); 
+	fclose(f); 
+	printf("Packed %d tiles and %d sprites into %d pages\n", (int) tiles.size(), (int) sprites.size(), page_count); 
+	return 0; 
+}
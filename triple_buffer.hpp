@@ -0,0 +1,41 @@
+#ifndef HEADERFILE_TRIPLE_BUFFER
+#define HEADERFILE_TRIPLE_BUFFER
+
+#include <atomic>
+
+/*
+Hands the latest value from one writer thread to one reader thread without either ever waiting.
+The writer fills its back slot and publishes it, the reader takes whatever was published last,
+and the third slot sits between them. Values published while the reader is busy replace each
+other, so the reader always sees the newest and never a half written one. Slots are reused,
+so values that own memory (vectors) keep their capacity.
+*/
+template <typename T>
+struct TripleBuffer {
+	static const int FRESH = 4; //Set on middle until the reader takes it.
+
+	T slots[3] = {}; 
+	std::atomic<int> middle; 
+	int back; //Only touched by the writer.
+	int front; //Only touched by the reader.
+
+	TripleBuffer() : middle(1), back(0), front(2) {}
+
+	T* write_slot() { return &slots[back]; }
+	void publish() {
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & ~FRESH; 
+	}
+	//For the writer: true once the reader has taken the last publish, or before the first. 
+	bool taken() const {
+		return !(middle.load(std::memory_order_acquire) & FRESH); 
+	}
+	//Moves to the newest published value. False, leaving read_slot as is, if nothing is new.
+	bool take() {
+		if(!(middle.load(std::memory_order_acquire) & FRESH)) return false; 
+		front = middle.exchange(front, std::memory_order_acq_rel) & ~FRESH; 
+		return true; 
+	}
+	const T* read_slot() const { return &slots[front]; }
+}; 
+
+#endif